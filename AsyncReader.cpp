@@ -0,0 +1,234 @@
+#include "AsyncReader.h"
+
+#include <cassert>
+#include <stdexcept>
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#ifdef WORLD_STREAMING_IO_URING
+#include <liburing.h>
+#endif
+
+namespace
+{
+    uint64_t AlignUp(uint64_t value)
+    {
+        return (value + AsyncReader::SectorSize - 1) / AsyncReader::SectorSize * AsyncReader::SectorSize;
+    }
+}
+
+AsyncReader::AsyncReader(const std::filesystem::path& path, uint32_t bufferCount, uint32_t maxReadSize) :
+    m_BufferCount(bufferCount), m_BufferSize(AlignUp(maxReadSize) + SectorSize), // a read may start a sector early
+    m_Requests(bufferCount), m_Completions(bufferCount)
+{
+    // direct I/O bypasses the OS cache, file systems without it get a buffered handle
+#ifdef _WIN32
+    m_File = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_NO_BUFFERING, nullptr);
+    m_Direct = m_File != INVALID_HANDLE_VALUE;
+    if (!m_Direct)
+        m_File = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (m_File == INVALID_HANDLE_VALUE) throw std::runtime_error("can't open " + path.string());
+#else
+    m_File = open(path.c_str(), O_RDONLY | O_DIRECT);
+    m_Direct = m_File >= 0;
+    if (!m_Direct) m_File = open(path.c_str(), O_RDONLY);
+    if (m_File < 0) throw std::runtime_error("can't open " + path.string());
+#endif
+
+#ifdef WORLD_STREAMING_IO_URING
+    m_Ring = std::make_unique<io_uring>();
+    if (io_uring_queue_init(bufferCount, m_Ring.get(), 0) != 0) m_Ring = nullptr;
+#endif
+
+    m_Buffers.resize(m_BufferSize * bufferCount);
+    m_Cancelled = std::make_unique<std::atomic<bool>[]>(bufferCount);
+    for (uint32_t buffer = bufferCount; buffer > 0; --buffer) m_FreeBuffers.push_back(buffer - 1);
+    m_Thread = std::thread(&AsyncReader::Run, this);
+}
+
+AsyncReader::~AsyncReader()
+{
+    // reads in flight finish first, their buffers are still owned here
+    {
+        std::lock_guard lock(m_WakeMutex);
+        m_Stop = true;
+    }
+    m_Wake.notify_one();
+    m_Thread.join();
+
+#ifdef WORLD_STREAMING_IO_URING
+    if (m_Ring != nullptr) io_uring_queue_exit(m_Ring.get());
+#endif
+#ifdef _WIN32
+    CloseHandle(m_File);
+#else
+    close(m_File);
+#endif
+}
+
+uint32_t AsyncReader::Submit(uint64_t offset, uint32_t size, uint64_t tag)
+{
+    if (m_FreeBuffers.empty()) return NoBuffer;
+
+    Request request;
+    request.Offset = offset / SectorSize * SectorSize;
+    request.Skew = static_cast<uint32_t>(offset - request.Offset);
+    request.Needed = request.Skew + size;
+    request.Size = static_cast<uint32_t>(AlignUp(request.Needed));
+    request.Buffer = m_FreeBuffers.back();
+    request.Tag = tag;
+    assert(request.Size <= m_BufferSize);
+
+    m_FreeBuffers.pop_back();
+    m_Cancelled[request.Buffer].store(false, std::memory_order_relaxed); // published by the push
+    m_Requests.TryPush(request); // never full, there are as many slots as buffers
+    {
+        std::lock_guard lock(m_WakeMutex);
+    }
+    m_Wake.notify_one();
+    return request.Buffer;
+}
+
+void AsyncReader::Cancel(uint32_t buffer)
+{
+    m_Cancelled[buffer].store(true, std::memory_order_relaxed);
+}
+
+bool AsyncReader::Poll(Completion& completion)
+{
+    return m_Completions.TryPop(completion);
+}
+
+void AsyncReader::Release(uint32_t buffer)
+{
+    m_FreeBuffers.push_back(buffer);
+}
+
+const char* AsyncReader::GetBackendName() const
+{
+#ifdef WORLD_STREAMING_IO_URING
+    if (m_Ring != nullptr) return "io_uring";
+#endif
+    return "I/O thread";
+}
+
+void AsyncReader::Run()
+{
+#ifdef WORLD_STREAMING_IO_URING
+    if (m_Ring != nullptr)
+    {
+        RunRing();
+        return;
+    }
+#endif
+    RunBlocking();
+}
+
+void AsyncReader::RunBlocking()
+{
+    for (;;)
+    {
+        Request request;
+        if (m_Requests.TryPop(request))
+        {
+            if (!Skip(request)) Complete(request, Read(request));
+            continue;
+        }
+
+        std::unique_lock lock(m_WakeMutex);
+        m_Wake.wait(lock, [this] { return m_Stop || !m_Requests.IsEmpty(); });
+        if (m_Stop && m_Requests.IsEmpty()) return;
+    }
+}
+
+#ifdef WORLD_STREAMING_IO_URING
+void AsyncReader::RunRing()
+{
+    // the ring has an entry per buffer, so every queued request fits
+    std::vector<Request> inFlight(m_BufferCount);
+    uint32_t inFlightCount = 0;
+    for (;;)
+    {
+        Request request;
+        uint32_t queued = 0;
+        while (m_Requests.TryPop(request))
+        {
+            if (Skip(request)) continue;
+            io_uring_sqe* sqe = io_uring_get_sqe(m_Ring.get());
+            io_uring_prep_read(sqe, m_File, GetBuffer(request.Buffer), request.Size, request.Offset);
+            io_uring_sqe_set_data(sqe, reinterpret_cast<void*>(static_cast<uintptr_t>(request.Buffer)));
+            inFlight[request.Buffer] = request;
+            ++queued;
+        }
+        if (queued > 0)
+        {
+            // one submission for the whole batch
+            io_uring_submit(m_Ring.get());
+            inFlightCount += queued;
+        }
+
+        if (inFlightCount > 0)
+        {
+            // a short wait, so requests arriving meanwhile still join the queue
+            io_uring_cqe* cqe = nullptr;
+            __kernel_timespec timeout{ 0, 1000000 };
+            if (io_uring_wait_cqe_timeout(m_Ring.get(), &cqe, &timeout) != 0) continue;
+
+            unsigned head = 0, seen = 0;
+            io_uring_for_each_cqe(m_Ring.get(), head, cqe)
+            {
+                const auto buffer = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(io_uring_cqe_get_data(cqe)));
+                Complete(inFlight[buffer], cqe->res);
+                ++seen;
+            }
+            io_uring_cq_advance(m_Ring.get(), seen);
+            inFlightCount -= seen;
+            continue;
+        }
+
+        std::unique_lock lock(m_WakeMutex);
+        m_Wake.wait(lock, [this] { return m_Stop || !m_Requests.IsEmpty(); });
+        if (m_Stop && m_Requests.IsEmpty()) return;
+    }
+}
+#endif
+
+int64_t AsyncReader::Read(const Request& request)
+{
+    uint8_t* buffer = GetBuffer(request.Buffer);
+#ifdef _WIN32
+    // a synchronous handle reads at the offset given in the OVERLAPPED
+    OVERLAPPED overlapped{};
+    overlapped.Offset = static_cast<DWORD>(request.Offset);
+    overlapped.OffsetHigh = static_cast<DWORD>(request.Offset >> 32);
+    DWORD bytes = 0;
+    if (!ReadFile(m_File, buffer, request.Size, &bytes, &overlapped) && GetLastError() != ERROR_HANDLE_EOF) return -1;
+    return bytes;
+#else
+    // short only at the end of the file, which the last cell's rounded up size runs past
+    return pread(m_File, buffer, request.Size, static_cast<off_t>(request.Offset));
+#endif
+}
+
+bool AsyncReader::Skip(const Request& request)
+{
+    if (!m_Cancelled[request.Buffer].load(std::memory_order_relaxed)) return false;
+    Complete(request, -1, true);
+    return true;
+}
+
+void AsyncReader::Complete(const Request& request, int64_t bytes, bool cancelled)
+{
+    Completion completion;
+    completion.Tag = request.Tag;
+    completion.Buffer = request.Buffer;
+    completion.Data = GetBuffer(request.Buffer) + request.Skew;
+    completion.Succeeded = bytes >= request.Needed;
+    completion.Cancelled = cancelled;
+    m_Completions.TryPush(completion); // never full, see Submit
+}
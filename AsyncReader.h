@@ -0,0 +1,108 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <xsimd/xsimd.hpp>
+#include "SpscQueue.h"
+
+// io_uring is opt in: a build defining WORLD_STREAMING_IO_URING must also link liburing (-luring)
+#if defined(WORLD_STREAMING_IO_URING) && !defined(__linux__)
+#error "WORLD_STREAMING_IO_URING needs Linux"
+#endif
+
+#ifdef WORLD_STREAMING_IO_URING
+struct io_uring;
+#endif
+
+// Reads file ranges into preallocated sector aligned buffers on a dedicated I/O thread, so reads never
+// occupy g_Context.Pool. Requests and completions pass through lock-free queues. With io_uring the thread
+// keeps every free buffer's read in flight at once, otherwise it issues blocking reads one after another.
+// The file is opened for direct (unbuffered) I/O where the file system allows it.
+class AsyncReader
+{
+public:
+    static constexpr uint32_t SectorSize = 4096; // offset, size and address alignment for direct I/O
+    static constexpr uint32_t NoBuffer = UINT32_MAX;
+
+    struct Completion
+    {
+        uint64_t Tag = 0;
+        uint32_t Buffer = 0;
+        const uint8_t* Data = nullptr; // the requested offset, inside the buffer
+        bool Succeeded = false;
+        bool Cancelled = false; // skipped before it was issued
+    };
+
+    // throws std::runtime_error if the file can't be opened; maxReadSize is the largest Submit size
+    AsyncReader(const std::filesystem::path& path, uint32_t bufferCount, uint32_t maxReadSize);
+    ~AsyncReader();
+
+    AsyncReader(const AsyncReader&) = delete;
+    AsyncReader& operator=(const AsyncReader&) = delete;
+
+    // Queues a read of size bytes at offset into a free buffer and returns the buffer, NoBuffer if all are
+    // taken. Submit, Cancel, Poll and Release are for one thread.
+    uint32_t Submit(uint64_t offset, uint32_t size, uint64_t tag);
+    // The read into buffer is skipped if it hasn't been issued yet, it completes either way
+    void Cancel(uint32_t buffer);
+    // Pops a finished read, its buffer stays taken until released
+    bool Poll(Completion& completion);
+    void Release(uint32_t buffer);
+
+    [[nodiscard]] uint32_t GetFreeBufferCount() const { return static_cast<uint32_t>(m_FreeBuffers.size()); }
+    [[nodiscard]] uint32_t GetBufferCount() const { return m_BufferCount; }
+    [[nodiscard]] size_t GetMemoryUsage() const { return m_Buffers.capacity(); }
+    [[nodiscard]] const char* GetBackendName() const;
+    [[nodiscard]] bool IsDirect() const { return m_Direct; }
+
+private:
+    struct Request
+    {
+        uint64_t Offset = 0; // sector aligned
+        uint32_t Size = 0; // sector aligned
+        uint32_t Needed = 0; // bytes that must be read for the request to succeed
+        uint32_t Skew = 0; // from Offset to the requested offset
+        uint32_t Buffer = 0;
+        uint64_t Tag = 0;
+    };
+
+    void Run();
+    void RunBlocking();
+#ifdef WORLD_STREAMING_IO_URING
+    void RunRing();
+#endif
+    // bytes read, negative on failure
+    int64_t Read(const Request& request);
+    void Complete(const Request& request, int64_t bytes, bool cancelled = false);
+    // completes a cancelled request without reading, true if it was
+    bool Skip(const Request& request);
+    [[nodiscard]] uint8_t* GetBuffer(uint32_t buffer) { return m_Buffers.data() + static_cast<size_t>(buffer) * m_BufferSize; }
+
+    uint32_t m_BufferCount = 0;
+    size_t m_BufferSize = 0;
+    std::vector<uint8_t, xsimd::aligned_allocator<uint8_t, SectorSize>> m_Buffers{};
+    std::vector<uint32_t> m_FreeBuffers{};
+    std::unique_ptr<std::atomic<bool>[]> m_Cancelled = nullptr; // per buffer
+    bool m_Direct = false;
+#ifdef WORLD_STREAMING_IO_URING
+    std::unique_ptr<io_uring> m_Ring = nullptr;
+#endif
+#ifdef _WIN32
+    void* m_File = nullptr;
+#else
+    int m_File = -1;
+#endif
+
+    SpscQueue<Request> m_Requests;
+    SpscQueue<Completion> m_Completions;
+    // only to wake the I/O thread when it has nothing in flight
+    std::mutex m_WakeMutex{};
+    std::condition_variable m_Wake{};
+    std::atomic<bool> m_Stop{ false };
+    std::thread m_Thread{};
+};
@@ -44,23 +44,23 @@ namespace
     }
 }
 
-BvhTree::BvhTree(std::vector<StaticObject>& objects, uint32_t maxObjInNode, SpitMethod method) :
+BvhTree::BvhTree(ObjectStore& objects, uint32_t maxObjInNode, SpitMethod method) :
     m_MaxObjInNode(maxObjInNode), m_SplitMethod(method)
 {
-    if (objects.empty()) return;
+    if (objects.IsEmpty()) return;
 
-    std::vector<BvhObjectInfo> objInfo(objects.size());
-    for (uint32_t i = 0; i < objects.size(); ++i)
+    std::vector<BvhObjectInfo> objInfo(objects.GetSize());
+    for (uint32_t i = 0; i < objects.GetSize(); ++i)
     {
-        objInfo[i] = BvhObjectInfo(i, BoundingSphere(objects[i].Position, objects[i].Scale));
+        objInfo[i] = BvhObjectInfo(i, objects.GetBound(i));
     }
 
-    std::vector<StaticObject> orderedObjects;
-    orderedObjects.reserve(objects.size());
+    std::vector<uint32_t> order;
+    order.reserve(objects.GetSize());
     uint32_t totalNodes = 0;
-    auto root = BuildBvh(objInfo, 0, objects.size(), totalNodes, objects, orderedObjects);
+    auto root = BuildBvh(objInfo, 0, objects.GetSize(), totalNodes, order);
 
-    objects.swap(orderedObjects);
+    objects.Permute(order);
 
     uint32_t offset = 0;
     m_Nodes.resize(totalNodes);
@@ -69,58 +69,122 @@ BvhTree::BvhTree(std::vector<StaticObject>& objects, uint32_t maxObjInNode, Spit
     root = nullptr;
 }
 
-std::vector<uint32_t> BvhTree::TickCulling(const BoundingFrustum& frustum) const
+BvhTree::BvhTree(std::vector<BvhLinearNode> nodes, uint32_t maxObjInNode, SpitMethod method) :
+    m_Nodes(std::move(nodes)), m_MaxObjInNode(maxObjInNode), m_SplitMethod(method)
 {
-    std::vector<uint32_t> result;
+}
 
-    if (m_Nodes.empty()) return result;
+void AppendObjectRange(std::vector<BvhObjectRange>& ranges, const BvhObjectRange& range)
+{
+    if (!ranges.empty() && ranges.back().Contained == range.Contained &&
+        ranges.back().Offset + ranges.back().Count == range.Offset)
+        ranges.back().Count += range.Count;
+    else
+        ranges.push_back(range);
+}
 
-    std::stack<uint32_t> toVisit;
-    toVisit.push(0);
+std::vector<BvhObjectRange> BvhTree::TickCulling(const CullingContext& context) const
+{
+    std::vector<BvhObjectRange> result;
+    uint32_t nodesVisited = 0;
+    if (!m_Nodes.empty()) TickCulling(context, 0, false, result, nodesVisited);
+    return result;
+}
+
+void BvhTree::TickCulling(const CullingContext& context, uint32_t root, bool rootContained,
+    std::vector<BvhObjectRange>& result, uint32_t& nodesVisited) const
+{
+    // depth first in object order, so leaves come out sorted and adjacent ones can be merged
+    std::stack<std::pair<uint32_t, bool>> toVisit;
+    toVisit.emplace(root, rootContained);
     while (!toVisit.empty())
     {
-        const BvhLinearNode& node = m_Nodes[toVisit.top()];
-        const uint32_t firstChildOffset = toVisit.top() + 1;
+        const auto [nodeIdx, parentContained] = toVisit.top();
+        const BvhLinearNode& node = m_Nodes[nodeIdx];
+        const uint32_t firstChildOffset = nodeIdx + 1;
         toVisit.pop();
-        const auto contain = frustum.Contains(node.Bound);
+        const auto contain = Test(context, node, parentContained);
+        ++nodesVisited;
 
-        if (contain != DISJOINT)
+        if (contain != CullingContext::Containment::Disjoint)
         {
+            const bool contained = parentContained || contain == CullingContext::Containment::Contains;
             if (node.ObjectCount > 0)
             {
-                for (uint32_t i = 0; i < node.ObjectCount; ++i)
-                    result.push_back(node.ObjectOffset + i);
+                AppendObjectRange(result, { node.ObjectOffset, node.ObjectCount, contained });
             }
             else
             {
-                toVisit.push(node.SecondChildOffset);
-                toVisit.push(firstChildOffset);
+                toVisit.emplace(node.SecondChildOffset, contained);
+                toVisit.emplace(firstChildOffset, contained);
             }
         }
     }
+}
 
+std::vector<BvhSubtree> BvhTree::GetFrontier(const CullingContext& context, uint32_t depth, uint32_t& nodesVisited) const
+{
+    std::vector<BvhSubtree> result;
+    if (m_Nodes.empty()) return result;
+
+    std::stack<std::pair<uint32_t, uint32_t>> toVisit;
+    toVisit.emplace(0, 0);
+    while (!toVisit.empty())
+    {
+        const auto [nodeIdx, nodeDepth] = toVisit.top();
+        const BvhLinearNode& node = m_Nodes[nodeIdx];
+        toVisit.pop();
+        const auto contain = Test(context, node, false);
+        ++nodesVisited;
+        if (contain == CullingContext::Containment::Disjoint) continue;
+
+        if (node.ObjectCount == 0 && nodeDepth < depth && contain != CullingContext::Containment::Contains)
+        {
+            toVisit.emplace(node.SecondChildOffset, nodeDepth + 1);
+            toVisit.emplace(nodeIdx + 1, nodeDepth + 1);
+            continue;
+        }
+
+        // the subtree's objects and nodes are contiguous, bounded by its leftmost and rightmost leaves
+        uint32_t first = nodeIdx, last = nodeIdx;
+        while (m_Nodes[first].ObjectCount == 0) first = first + 1;
+        while (m_Nodes[last].ObjectCount == 0) last = m_Nodes[last].SecondChildOffset;
+        const uint32_t offset = m_Nodes[first].ObjectOffset;
+        result.push_back({ nodeIdx, last - nodeIdx + 1, offset,
+            m_Nodes[last].ObjectOffset + m_Nodes[last].ObjectCount - offset,
+            contain == CullingContext::Containment::Contains });
+    }
     return result;
 }
 
-void BvhTree::GenerateTree(std::vector<StaticObject>& objects, uint32_t maxObjInNode, SpitMethod method)
+CullingContext::Containment BvhTree::Test(const CullingContext& context, const BvhLinearNode& node, bool parentContained)
+{
+    // below a contained node only the projected size and draw distance can still reject
+    return parentContained && !context.HasContributionCulling() && node.MaxDrawDistance == FLT_MAX ?
+        CullingContext::Containment::Contains : context.Test(node.Bound, node.MaxDrawDistance);
+}
+
+void BvhTree::GenerateTree(ObjectStore& objects, uint32_t maxObjInNode, SpitMethod method)
 {
     m_MaxObjInNode = maxObjInNode;
     m_SplitMethod = method;
+    m_ObjectBase = 0;
+    m_Nodes.clear();
 
-    if (objects.empty()) return;
+    if (objects.IsEmpty()) return;
 
-    std::vector<BvhObjectInfo> objInfo(objects.size());
-    for (uint32_t i = 0; i < objects.size(); ++i)
+    std::vector<BvhObjectInfo> objInfo(objects.GetSize());
+    for (uint32_t i = 0; i < objects.GetSize(); ++i)
     {
-        objInfo[i] = BvhObjectInfo(i, BoundingSphere(objects[i].Position, objects[i].Scale));
+        objInfo[i] = BvhObjectInfo(i, objects.GetBound(i));
     }
 
-    std::vector<StaticObject> orderedObjects;
-    orderedObjects.reserve(objects.size());
+    std::vector<uint32_t> order;
+    order.reserve(objects.GetSize());
     uint32_t totalNodes = 0;
-    auto root = BuildBvh(objInfo, 0, objects.size(), totalNodes, objects, orderedObjects);
+    auto root = BuildBvh(objInfo, 0, objects.GetSize(), totalNodes, order);
 
-    objects.swap(orderedObjects);
+    objects.Permute(order);
 
     uint32_t offset = 0;
     m_Nodes.resize(totalNodes);
@@ -129,9 +193,53 @@ void BvhTree::GenerateTree(std::vector<StaticObject>& objects, uint32_t maxObjIn
     root = nullptr;
 }
 
+void BvhTree::SetObjectBase(uint32_t base)
+{
+    for (BvhLinearNode& node : m_Nodes)
+        if (node.ObjectCount > 0) node.ObjectOffset = node.ObjectOffset - m_ObjectBase + base;
+    m_ObjectBase = base;
+}
+
+void BvhTree::Refit(const ObjectStore& objects, const std::vector<float>& drawDistances)
+{
+    // children are always stored after their parent, so a reverse sweep sees them first
+    for (uint32_t i = static_cast<uint32_t>(m_Nodes.size()); i-- > 0;)
+    {
+        BvhLinearNode& node = m_Nodes[i];
+        if (node.ObjectCount > 0)
+        {
+            node.Bound = objects.GetBound(node.ObjectOffset);
+            for (uint32_t j = node.ObjectOffset + 1; j < node.ObjectOffset + node.ObjectCount; ++j)
+                BoundingSphere::CreateMerged(node.Bound, node.Bound, objects.GetBound(j));
+
+            // an object is drawn within its distance of its own center, shift that to the node center
+            node.MaxDrawDistance = 0.0f;
+            for (uint32_t j = node.ObjectOffset; j < node.ObjectOffset + node.ObjectCount; ++j)
+            {
+                const float distance = drawDistances[j] < FLT_MAX ?
+                    drawDistances[j] + Vector3::Distance(objects.GetPosition(j), node.Bound.Center) : FLT_MAX;
+                node.MaxDrawDistance = std::max(node.MaxDrawDistance, distance);
+            }
+        }
+        else
+        {
+            const BvhLinearNode& first = m_Nodes[i + 1];
+            const BvhLinearNode& second = m_Nodes[node.SecondChildOffset];
+            BoundingSphere::CreateMerged(node.Bound, first.Bound, second.Bound);
+            node.MaxDrawDistance = 0.0f;
+            for (const BvhLinearNode* child : { &first, &second })
+            {
+                const float distance = child->MaxDrawDistance < FLT_MAX ?
+                    child->MaxDrawDistance + Vector3::Distance(child->Bound.Center, node.Bound.Center) : FLT_MAX;
+                node.MaxDrawDistance = std::max(node.MaxDrawDistance, distance);
+            }
+        }
+    }
+}
+
 std::unique_ptr<BvhNode> BvhTree::BuildBvh(
     std::vector<BvhObjectInfo>& objInfo, uint32_t start, uint32_t end,
-    uint32_t& totalNodes, std::vector<StaticObject>& objects, std::vector<StaticObject>& orderedObj)
+    uint32_t& totalNodes, std::vector<uint32_t>& order)
 {
     std::unique_ptr<BvhNode> node = std::make_unique<BvhNode>();
     ++totalNodes;
@@ -147,10 +255,10 @@ std::unique_ptr<BvhNode> BvhTree::BuildBvh(
     const uint32_t nObj = end - start;
     if (nObj <= m_MaxObjInNode) // Create leaf
     {
-        const uint32_t orderedIdx = orderedObj.size();
+        const uint32_t orderedIdx = order.size();
         for (uint32_t i = start; i < end; ++i)
         {
-            orderedObj.push_back(objects[objInfo[i].ObjectIndex]);
+            order.push_back(objInfo[i].ObjectIndex);
         }
         node->InitLeaf(orderedIdx, nObj, allBound);
         return node;
@@ -254,9 +362,9 @@ std::unique_ptr<BvhNode> BvhTree::BuildBvh(
         }
         else
         {
-            const uint32_t orderedIdx = orderedObj.size();
+            const uint32_t orderedIdx = order.size();
             for (uint32_t i = start; i < end; ++i)
-                orderedObj.push_back(objects[objInfo[i].ObjectIndex]);
+                order.push_back(objInfo[i].ObjectIndex);
 
             node->InitLeaf(orderedIdx, nObj, allBound);
             return node;
@@ -264,8 +372,8 @@ std::unique_ptr<BvhNode> BvhTree::BuildBvh(
     }
 
     node->InitInterior(
-        BuildBvh(objInfo, start, mid, totalNodes, objects, orderedObj),
-        BuildBvh(objInfo, mid, end, totalNodes, objects, orderedObj));
+        BuildBvh(objInfo, start, mid, totalNodes, order),
+        BuildBvh(objInfo, mid, end, totalNodes, order));
 
     return node;
 }
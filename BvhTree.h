@@ -1,8 +1,11 @@
 #pragma once
 
+#include <cfloat>
 #include <memory>
+#include <vector>
 #include <directxtk/SimpleMath.h>
-#include "StaticObject.h"
+#include "CullingContext.h"
+#include "ObjectStore.h"
 
 struct BvhObjectInfo;
 struct BvhLinearNode
@@ -14,10 +17,33 @@ struct BvhLinearNode
         uint32_t SecondChildOffset;
     };
     uint32_t ObjectCount{};
+    // furthest camera distance from Bound's center at which any object below can still be drawn
+    float MaxDrawDistance = FLT_MAX;
 
     BvhLinearNode() = default;
 };
 
+// Contiguous run of BVH ordered objects, Contained when the whole run is inside the frustum
+struct BvhObjectRange
+{
+    uint32_t Offset{};
+    uint32_t Count{};
+    bool Contained{};
+};
+
+// Appends range, merging it into the last one when they are adjacent with the same Contained flag
+void AppendObjectRange(std::vector<BvhObjectRange>& ranges, const BvhObjectRange& range);
+
+// Root of a subtree that survived the top levels of traversal, see BvhTree::GetFrontier
+struct BvhSubtree
+{
+    uint32_t Node{};
+    uint32_t NodeCount{};
+    uint32_t ObjectOffset{};
+    uint32_t ObjectCount{};
+    bool Contained{};
+};
+
 struct BvhNode
 {
     DirectX::BoundingSphere Bound;
@@ -55,21 +81,41 @@ public:
         VolumeHeuristic,
     };
 
-    BvhTree(std::vector<StaticObject>& objects, uint32_t maxObjInNode, SpitMethod method);
-    [[nodiscard]] std::vector<uint32_t> TickCulling(const DirectX::BoundingFrustum& frustum) const;
+    BvhTree(ObjectStore& objects, uint32_t maxObjInNode, SpitMethod method);
+    // Takes nodes built earlier with the given settings over objects already in their order, see WorldFile
+    BvhTree(std::vector<BvhLinearNode> nodes, uint32_t maxObjInNode, SpitMethod method);
+    // Leaf ranges in object order, adjacent leaves are merged
+    [[nodiscard]] std::vector<BvhObjectRange> TickCulling(const CullingContext& context) const;
+    // Traverses the subtree at root, appending its ranges to result
+    void TickCulling(const CullingContext& context, uint32_t root, bool rootContained,
+        std::vector<BvhObjectRange>& result, uint32_t& nodesVisited) const;
+    // Visible subtrees at depth, or shallower leaves and contained nodes, in object order
+    [[nodiscard]] std::vector<BvhSubtree> GetFrontier(const CullingContext& context, uint32_t depth,
+        uint32_t& nodesVisited) const;
 
     [[nodiscard]] const std::vector<BvhLinearNode>& GetTree() const { return m_Nodes; }
 
-    void GenerateTree(std::vector<StaticObject>& objects, uint32_t maxObjInNode, SpitMethod method);
+    // Shifts the object offsets of the leaves to start at base, for trees built over a copy of their objects
+    void SetObjectBase(uint32_t base);
+    [[nodiscard]] uint32_t GetObjectBase() const { return m_ObjectBase; }
+
+    void GenerateTree(ObjectStore& objects, uint32_t maxObjInNode, SpitMethod method);
+    // Recomputes node bounds and draw distances bottom up after objects changed in place, topology
+    // is kept. drawDistances is index aligned with objects, FLT_MAX for no limit.
+    void Refit(const ObjectStore& objects, const std::vector<float>& drawDistances);
 
 private:
 
+    [[nodiscard]] static CullingContext::Containment Test(const CullingContext& context, const BvhLinearNode& node,
+        bool parentContained);
+
     std::unique_ptr<BvhNode> BuildBvh(std::vector<BvhObjectInfo>& objInfo, uint32_t start, uint32_t end,
-                                      uint32_t& totalNodes, std::vector<StaticObject>& objects, std::vector<StaticObject>& orderedObj);
+                                      uint32_t& totalNodes, std::vector<uint32_t>& order);
 
     uint32_t FlattenBvhTree(const BvhNode* node, uint32_t& offset);
 
     std::vector<BvhLinearNode> m_Nodes{};
+    uint32_t m_ObjectBase = 0;
     uint32_t m_MaxObjInNode;
     SpitMethod m_SplitMethod;
 };
@@ -20,12 +20,12 @@ Matrix Camera::GetViewProjectionMatrix() const
     return GetViewMatrix() * GetProjectionMatrix();
 }
 
-BoundingFrustum Camera::GetFrustum() const
+CullingContext Camera::GetCullingContext(float minScreenRadius) const
 {
-    BoundingFrustum frustum(GetProjectionMatrix());
-    frustum.Transform(frustum, Matrix::CreateFromYawPitchRoll(m_Rotation) * 
-        Matrix::CreateTranslation(m_Position));
-    return frustum;
+    // pixels per unit of radius over distance, cot(fov / 2) scaled to half the viewport height
+    const float projectionScale = GetProjectionMatrix()._22 * m_Viewport.Height * 0.5f;
+    return CullingContext(GetViewProjectionMatrix(), m_Position, m_Forward, m_NearPlane, m_FarPlane,
+        projectionScale, minScreenRadius);
 }
 
 Vector3 Camera::GetPosition() const
@@ -33,6 +33,11 @@ Vector3 Camera::GetPosition() const
     return m_Position;
 }
 
+Vector3 Camera::GetForward() const
+{
+    return m_Forward;
+}
+
 void Camera::SetViewPort(ID3D11DeviceContext* context) const
 {
     context->RSSetViewports(1, &m_Viewport);
@@ -3,6 +3,7 @@
 #include <directxtk/SimpleMath.h>
 #include <d3d11.h>
 #include "imgui.h"
+#include "CullingContext.h"
 
 class Camera
 {
@@ -11,8 +12,10 @@ public:
     [[nodiscard]] DirectX::SimpleMath::Matrix  GetViewMatrix() const;
     [[nodiscard]] DirectX::SimpleMath::Matrix  GetProjectionMatrix() const;
     [[nodiscard]] DirectX::SimpleMath::Matrix  GetViewProjectionMatrix() const;
-    [[nodiscard]] DirectX::BoundingFrustum     GetFrustum() const;
+    // spheres projecting to less than minScreenRadius pixels are culled, 0 disables
+    [[nodiscard]] CullingContext               GetCullingContext(float minScreenRadius = 0.0f) const;
     [[nodiscard]] DirectX::SimpleMath::Vector3 GetPosition() const;
+    [[nodiscard]] DirectX::SimpleMath::Vector3 GetForward() const;
     void SetViewPort(ID3D11DeviceContext* context) const;
 
     void Update(const ImGuiIO& io);
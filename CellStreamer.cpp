@@ -0,0 +1,317 @@
+#include "CellStreamer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include "ThreadPool.h"
+
+using namespace DirectX::SimpleMath;
+
+namespace
+{
+    constexpr uint32_t READ_QUEUE_DEPTH = 32; // reads in flight, each with a buffer of the largest cell
+    constexpr float VISIBLE_PRIORITY = 0.5f; // cells in the frustum are treated as this much closer
+    constexpr float LOOKAHEAD_SECONDS = 1.0f; // cells the camera reaches within this are treated as reached
+    constexpr uint32_t PREFETCH_STEPS = 8; // points the predicted path is sampled at
+    constexpr uint32_t PREFETCH_READS = 8; // buffers prefetches may hold, the rest stay free for cells in range
+    constexpr size_t STREAMING_THREADS = 2; // decode and BVH build workers
+    constexpr uint32_t MAX_DECODES = 4; // cells decoding at once, further reads wait in the reader
+    constexpr uint32_t MAX_LOAD_ATTEMPTS = 3; // failed loads before a cell is given up on
+    constexpr uint32_t RETRY_UPDATES = 30; // updates before the first retry of a failed load, doubled per failure
+}
+
+CellStreamer::CellStreamer(const std::filesystem::path& path) :
+    m_File(std::make_shared<const WorldFile>(path)), m_Grid(m_File->GetGrid()),
+    m_MaxCellObjects(m_File->GetHeader().MaxCellObjects)
+{
+    m_States.resize(m_Grid.GetCellCount(), CellState::Unloaded);
+    for (uint32_t cell = 0; cell < m_States.size(); ++cell)
+        if (m_File->GetCell(cell).ObjectCount == 0) m_States[cell] = CellState::Empty;
+    m_ReadBuffers.resize(m_Grid.GetCellCount(), AsyncReader::NoBuffer);
+    m_Prefetching.resize(m_Grid.GetCellCount(), false);
+    m_Failures.resize(m_Grid.GetCellCount(), 0);
+    m_RetryUpdates.resize(m_Grid.GetCellCount(), 0);
+    m_Reader = std::make_unique<AsyncReader>(path, READ_QUEUE_DEPTH, m_File->GetHeader().MaxCellBytes);
+    m_Workers = std::make_unique<ThreadPool>(STREAMING_THREADS);
+}
+
+CellStreamer::~CellStreamer()
+{
+    // decodes read from the reader's buffers, reads in flight are waited for by the reader
+    for (auto& pending : m_Pending) pending.Result.wait();
+}
+
+void CellStreamer::SetRadii(float inner, float outer)
+{
+    m_InnerRadius = std::max(inner, 0.0f);
+    m_OuterRadius = std::max(outer, m_InnerRadius);
+}
+
+void CellStreamer::SetBvhSettings(uint32_t maxObjInNode, BvhTree::SpitMethod method)
+{
+    m_MaxObjInNode = maxObjInNode;
+    m_SplitMethod = method;
+}
+
+void CellStreamer::SetPrefetchHorizon(float seconds)
+{
+    m_PrefetchHorizon = std::max(seconds, 0.0f);
+}
+
+void CellStreamer::Update(const StreamingView& view, std::vector<uint32_t>& unloads, uint32_t maxLoads)
+{
+    PredictPath(view);
+    ++m_UpdateCount;
+
+    // cells in range get priorities below the inner radius, prefetches above it, so they sort after
+    m_Candidates.clear();
+    size_t inRange = 0;
+    for (uint32_t cell = 0; cell < m_States.size(); ++cell)
+    {
+        const float distance = m_Grid.GetDistance(cell, view.Position);
+        switch (m_States[cell])
+        {
+        case CellState::Unloaded:
+            if (m_RetryUpdates[cell] > m_UpdateCount) break;
+            if (distance < m_InnerRadius)
+            {
+                m_Candidates.emplace_back(GetPriority(cell, distance, view), cell);
+                ++inRange;
+            }
+            else if (distance <= m_OuterRadius)
+            {
+                // sooner on the path first, past the outer radius it would be unloaded as soon as it arrived
+                const float time = GetPathTime(cell);
+                if (time >= 0.0f) m_Candidates.emplace_back(m_InnerRadius * (1.0f + time / m_PrefetchHorizon), cell);
+            }
+            break;
+        case CellState::Reading:
+            if (m_Prefetching[cell] && distance < m_InnerRadius)
+            {
+                m_Prefetching[cell] = false;
+                --m_PrefetchCount;
+            }
+            else if (m_Prefetching[cell] && distance <= m_OuterRadius && GetPathTime(cell) < 0.0f)
+            {
+                // the prediction was wrong, the buffer is better spent on cells still ahead
+                m_Reader->Cancel(m_ReadBuffers[cell]);
+                m_States[cell] = CellState::Cancelled;
+                ++m_DemotedCount;
+                break;
+            }
+            [[fallthrough]];
+        case CellState::Loading:
+            if (distance > m_OuterRadius)
+            {
+                // an unissued read is skipped, a decode finishes and is dropped
+                if (m_States[cell] == CellState::Reading) m_Reader->Cancel(m_ReadBuffers[cell]);
+                m_States[cell] = CellState::Cancelled;
+                ++m_CancelledCount;
+            }
+            break;
+        case CellState::Resident:
+            if (distance > m_OuterRadius)
+            {
+                m_States[cell] = CellState::Unloaded;
+                --m_ResidentCount;
+                unloads.push_back(cell);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    // as many as there are free buffers, the rest compete again next update
+    const size_t issued = std::min<size_t>({ m_Candidates.size(), m_Reader->GetFreeBufferCount(), maxLoads });
+    m_DeferredCount = static_cast<uint32_t>(inRange - std::min(inRange, issued));
+    std::partial_sort(m_Candidates.begin(), m_Candidates.begin() + issued, m_Candidates.end());
+    for (size_t i = 0; i < issued; ++i)
+    {
+        const bool prefetch = i >= inRange;
+        if (prefetch && m_PrefetchCount >= PREFETCH_READS) break;
+
+        const uint32_t cell = m_Candidates[i].second;
+        const WorldFileCell& entry = m_File->GetCell(cell);
+        m_ReadBuffers[cell] = m_Reader->Submit(entry.Offset, entry.Size, cell);
+        m_States[cell] = CellState::Reading;
+        m_Prefetching[cell] = prefetch;
+        m_PrefetchCount += prefetch;
+        ++m_ReadingCount;
+    }
+}
+
+void CellStreamer::PredictPath(const StreamingView& view)
+{
+    // velocity turns with the view, so a camera moving along where it looks curves with it
+    m_Path.clear();
+    if (m_PrefetchHorizon <= 0.0f || view.Velocity.LengthSquared() <= 0.0f) return;
+
+    const float step = m_PrefetchHorizon / static_cast<float>(PREFETCH_STEPS);
+    const Matrix turn = Matrix::CreateRotationY(-view.TurnRate * step);
+    Vector3 position = view.Position;
+    Vector3 velocity = view.Velocity;
+    Vector3 forward = view.Forward;
+    for (uint32_t i = 0; i < PREFETCH_STEPS; ++i)
+    {
+        velocity = Vector3::TransformNormal(velocity, turn);
+        forward = Vector3::TransformNormal(forward, turn);
+        position += velocity * step;
+        m_Path.emplace_back(position, forward);
+    }
+}
+
+float CellStreamer::GetPathTime(uint32_t cell) const
+{
+    // ahead means the cell's centre isn't more than a cell behind the predicted view
+    const Vector2 min = m_Grid.GetCellMin(cell);
+    const Vector3 centre(min.x + m_Grid.CellSize * 0.5f, 0.0f, min.y + m_Grid.CellSize * 0.5f);
+    for (size_t i = 0; i < m_Path.size(); ++i)
+    {
+        const auto& [position, forward] = m_Path[i];
+        const Vector3 offset(centre.x - position.x, 0.0f, centre.z - position.z);
+        if (m_Grid.GetDistance(cell, position) < m_InnerRadius && offset.Dot(forward) > -m_Grid.CellSize)
+            return m_PrefetchHorizon * static_cast<float>(i + 1) / static_cast<float>(m_Path.size());
+    }
+    return -1.0f;
+}
+
+void CellStreamer::Evict(uint32_t cell)
+{
+    if (m_States[cell] != CellState::Resident) return;
+    m_States[cell] = CellState::Unloaded;
+    --m_ResidentCount;
+}
+
+float CellStreamer::GetPriority(uint32_t cell, float distance, const StreamingView& view) const
+{
+    // where the camera will be counts as much as where it is
+    distance = std::min(distance, m_Grid.GetDistance(cell, view.Position + view.Velocity * LOOKAHEAD_SECONDS));
+
+    const WorldFileCell& entry = m_File->GetCell(cell);
+    if (entry.ObjectCount == 0) return distance;
+    const Vector3 min(entry.BoundsMin[0], entry.BoundsMin[1], entry.BoundsMin[2]);
+    const Vector3 max(entry.BoundsMax[0], entry.BoundsMax[1], entry.BoundsMax[2]);
+    const DirectX::BoundingSphere bound((min + max) * 0.5f, Vector3::Distance(min, max) * 0.5f);
+    return view.Frustum.Test(bound) == CullingContext::Containment::Disjoint ? distance : distance * VISIBLE_PRIORITY;
+}
+
+void CellStreamer::TakeCompleted(std::vector<CellLoad>& loads)
+{
+    AsyncReader::Completion completion;
+    while (m_Pending.size() < MAX_DECODES && m_Reader->Poll(completion))
+    {
+        const auto cell = static_cast<uint32_t>(completion.Tag);
+        --m_ReadingCount;
+        m_ReadBuffers[cell] = AsyncReader::NoBuffer;
+        m_PrefetchCount -= m_Prefetching[cell];
+        m_Prefetching[cell] = false;
+        if (!completion.Succeeded || m_States[cell] == CellState::Cancelled)
+        {
+            m_Reader->Release(completion.Buffer);
+            m_States[cell] = CellState::Unloaded;
+            if (!completion.Succeeded && !completion.Cancelled)
+            {
+                ++m_FailedReadCount;
+                FailLoad(cell, "read");
+            }
+            continue;
+        }
+
+        // columns are compressed independently, each decodes on its own task straight into the cell's store
+        auto decode = std::make_shared<CellDecode>();
+        decode->Load.Cell = cell;
+        m_File->PrepareCell(cell, completion.Data, decode->Load.Objects);
+        m_States[cell] = CellState::Loading;
+        m_Pending.push_back({ cell, completion.Buffer, decode->Load.Objects.GetMemoryUsage(), decode, decode->Result.get_future() });
+        for (uint32_t column = 0; column < static_cast<uint32_t>(ObjectColumn::Count); ++column)
+        {
+            m_Workers->enqueue(&CellStreamer::DecodeColumn, decode, m_File, completion.Data,
+                static_cast<ObjectColumn>(column), m_MaxObjInNode, m_SplitMethod);
+        }
+    }
+
+    for (auto it = m_Pending.begin(); it != m_Pending.end();)
+    {
+        if (it->Result.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            ++it;
+            continue;
+        }
+
+        m_Reader->Release(it->Buffer);
+        if (it->Decode->Failed || m_States[it->Cell] == CellState::Cancelled)
+        {
+            // a cancelled cell that failed anyway would fail again when it comes back
+            m_States[it->Cell] = CellState::Unloaded;
+            if (it->Decode->Failed)
+            {
+                ++m_FailedReadCount;
+                FailLoad(it->Cell, "decode");
+            }
+        }
+        else
+        {
+            m_Failures[it->Cell] = 0;
+            m_States[it->Cell] = CellState::Resident;
+            ++m_ResidentCount;
+            loads.push_back(it->Result.get());
+        }
+        it = m_Pending.erase(it);
+    }
+}
+
+size_t CellStreamer::GetMemoryUsage() const
+{
+    // WorldFile::DecodeColumn keeps a column's compressed planes per worker thread
+    size_t bytes = m_Reader->GetMemoryUsage() + STREAMING_THREADS * m_MaxCellObjects * sizeof(float);
+    for (const auto& pending : m_Pending) bytes += pending.Bytes;
+    return bytes;
+}
+
+size_t CellStreamer::GetMaxStagingBytes() const
+{
+    // float mode, every column 4 bytes per object
+    return static_cast<size_t>(m_MaxCellObjects) * static_cast<uint32_t>(ObjectColumn::Count) * sizeof(float);
+}
+
+void CellStreamer::FailLoad(uint32_t cell, const char* what)
+{
+    if (++m_Failures[cell] < MAX_LOAD_ATTEMPTS)
+    {
+        m_RetryUpdates[cell] = m_UpdateCount + (RETRY_UPDATES << (m_Failures[cell] - 1));
+        return;
+    }
+
+    // the file is damaged or the read keeps failing, retrying every few updates would only spin
+    m_States[cell] = CellState::Failed;
+    ++m_FailedCellCount;
+    std::fprintf(stderr, "CellStreamer: cell %u failed to %s %u times, not loading it again\n", cell, what, MAX_LOAD_ATTEMPTS);
+}
+
+std::future<void> CellStreamer::Enqueue(std::function<void()> task)
+{
+    return m_Workers->enqueue(std::move(task));
+}
+
+void CellStreamer::DecodeColumn(const std::shared_ptr<CellDecode>& decode, const std::shared_ptr<const WorldFile>& file,
+    const uint8_t* block, ObjectColumn column, uint32_t maxObjInNode, BvhTree::SpitMethod method)
+{
+    CellLoad& load = decode->Load;
+    if (!file->DecodeColumn(load.Cell, block, column, load.Objects)) decode->Failed = true;
+    if (decode->Remaining.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+
+    // the stored BVH is taken as is unless the settings changed since the file was written,
+    // the file is BVH ordered, so a build then reorders little
+    if (!decode->Failed)
+    {
+        std::vector<BvhLinearNode> nodes;
+        const WorldFileHeader& header = file->GetHeader();
+        if (header.BvhMaxObjInNode == maxObjInNode && header.BvhMethod == static_cast<uint32_t>(method) &&
+            file->DecodeBvh(load.Cell, block, nodes))
+            load.Bvh = std::make_unique<BvhTree>(std::move(nodes), maxObjInNode, method);
+        else
+            load.Bvh = std::make_unique<BvhTree>(load.Objects, maxObjInNode, method);
+    }
+    decode->Result.set_value(std::move(load));
+}
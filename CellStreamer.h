@@ -0,0 +1,187 @@
+#pragma once
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <memory>
+#include <vector>
+#include <directxtk/SimpleMath.h>
+#include "AsyncReader.h"
+#include "BvhTree.h"
+#include "CullingContext.h"
+#include "ObjectStore.h"
+#include "WorldFile.h"
+#include "WorldGrid.h"
+
+class ThreadPool;
+
+// A cell decoded from the world file together with its BVH, stored in the file or built on a pool thread
+struct CellLoad
+{
+    uint32_t Cell = 0;
+    ObjectStore Objects{}; // BVH ordered
+    std::unique_ptr<BvhTree> Bvh = nullptr;
+};
+
+struct StreamingStats
+{
+    uint32_t ResidentCells = 0;
+    uint32_t ReadingCells = 0; // waiting on I/O
+    uint32_t LoadingCells = 0; // decoding and building their BVH
+    uint32_t ResidentObjects = 0;
+    uint32_t Slots = 0; // allocated cell slots, resident or free
+    uint32_t LoadedThisTick = 0;
+    uint32_t UnloadedThisTick = 0;
+    uint32_t CancelledLoads = 0; // since start, cells that left the outer radius while loading
+    uint32_t PrefetchReads = 0; // reads in flight for cells ahead on the predicted path
+    uint32_t DemotedPrefetches = 0; // since start, prefetch reads cancelled once the path turned away
+    uint32_t FailedCells = 0; // since start, cells given up on after failing to read or decode too often
+    float TopLevelBuildUs = 0.0f; // last rebuild of the BVH over resident cells
+};
+
+// Where the camera is and is heading, for load priorities
+struct StreamingView
+{
+    DirectX::SimpleMath::Vector3 Position{};
+    DirectX::SimpleMath::Vector3 Velocity{}; // units per second
+    DirectX::SimpleMath::Vector3 Forward{ 0.0f, 0.0f, 1.0f };
+    float TurnRate = 0.0f; // radians per second about the up axis, positive turns forward from x towards z
+    CullingContext Frustum{};
+};
+
+// Streams grid cells in and out around a position. Cells closer than the inner radius are read by an
+// AsyncReader, as many at once as it has buffers, then decoded a column per task on workers of its own,
+// so decodes and BVH builds never queue ahead of the frame's tasks on g_Context.Pool.
+// Cells waiting for a buffer are issued nearest first, weighted towards the frustum and where the camera
+// is heading. Resident cells further than the outer radius are unloaded and loads that get that far are
+// cancelled, the gap between the two radii keeps cells on the border from loading and unloading every
+// other tick.
+// Cells outside the inner radius that come inside it along the path the camera is predicted to take over
+// the prefetch horizon are read ahead, after every cell inside it and on a few buffers only. A prefetch
+// read for a cell the path no longer reaches is cancelled.
+// Cells the file lists without objects are never read.
+// A cell that fails to read or decode is retried after a backoff that doubles with each failure, after a few
+// failures it is given up on and logged.
+class CellStreamer
+{
+public:
+    // throws std::runtime_error if path isn't a readable world file, see WorldFile
+    explicit CellStreamer(const std::filesystem::path& path);
+    ~CellStreamer();
+
+    CellStreamer(const CellStreamer&) = delete;
+    CellStreamer& operator=(const CellStreamer&) = delete;
+
+    // outer is raised to inner if smaller
+    void SetRadii(float inner, float outer);
+    [[nodiscard]] float GetInnerRadius() const { return m_InnerRadius; }
+    [[nodiscard]] float GetOuterRadius() const { return m_OuterRadius; }
+    // used for loads issued from now on
+    void SetBvhSettings(uint32_t maxObjInNode, BvhTree::SpitMethod method);
+    // seconds the camera's motion and turning are extrapolated over, 0 disables prefetching
+    void SetPrefetchHorizon(float seconds);
+    [[nodiscard]] float GetPrefetchHorizon() const { return m_PrefetchHorizon; }
+
+    // Issues up to maxLoads reads for cells inside the inner radius by priority, then prefetches, cancels loads
+    // outside the outer radius and appends resident cells outside it to unloads, those are unloaded from here on
+    void Update(const StreamingView& view, std::vector<uint32_t>& unloads, uint32_t maxLoads = UINT32_MAX);
+    // Unloads a resident cell ahead of the outer radius, it is loaded again when it wins a read
+    void Evict(uint32_t cell);
+    // Starts decoding cells read since the last call, a few cells at a time, and moves finished loads to loads,
+    // their cells are resident from here on. Failed loads are retried by a later Update.
+    void TakeCompleted(std::vector<CellLoad>& loads);
+    // Runs task on the streaming workers, after the decodes queued before it
+    std::future<void> Enqueue(std::function<void()> task);
+
+    [[nodiscard]] const WorldGrid& GetGrid() const { return m_Grid; }
+    // objects in the largest cell
+    [[nodiscard]] uint32_t GetMaxCellObjects() const { return m_MaxCellObjects; }
+    [[nodiscard]] uint32_t GetResidentCount() const { return m_ResidentCount; }
+    [[nodiscard]] uint32_t GetReadingCount() const { return m_ReadingCount; }
+    [[nodiscard]] uint32_t GetLoadingCount() const { return static_cast<uint32_t>(m_Pending.size()); }
+    // reads that failed and cells that didn't decode
+    [[nodiscard]] uint32_t GetFailedReadCount() const { return m_FailedReadCount; }
+    // cells given up on
+    [[nodiscard]] uint32_t GetFailedCellCount() const { return m_FailedCellCount; }
+    [[nodiscard]] uint32_t GetCancelledCount() const { return m_CancelledCount; }
+    // cells inside the inner radius the last update couldn't read, for lack of buffers or maxLoads
+    [[nodiscard]] uint32_t GetDeferredCount() const { return m_DeferredCount; }
+    [[nodiscard]] uint32_t GetPrefetchCount() const { return m_PrefetchCount; }
+    [[nodiscard]] uint32_t GetDemotedCount() const { return m_DemotedCount; }
+    [[nodiscard]] const AsyncReader& GetReader() const { return *m_Reader; }
+    // Read buffers, decode scratch of the workers and the staging stores of cells decoding
+    [[nodiscard]] size_t GetMemoryUsage() const;
+    // staging store of the largest cell, what a read admitted now will take once it decodes
+    [[nodiscard]] size_t GetMaxStagingBytes() const;
+
+private:
+    enum class CellState : uint8_t
+    {
+        Unloaded,
+        Reading,
+        Loading,
+        Cancelled, // reading or loading, dropped once it completes
+        Resident,
+        Failed, // failed to load too often, not read again
+        Empty, // no objects, never read and never holds a slot
+    };
+
+    // lower first, the distance the cell is treated as being at
+    [[nodiscard]] float GetPriority(uint32_t cell, float distance, const StreamingView& view) const;
+    // Extrapolates view over the prefetch horizon into m_Path
+    void PredictPath(const StreamingView& view);
+    // Seconds until the cell comes inside the inner radius ahead of the camera on m_Path, negative if it doesn't
+    [[nodiscard]] float GetPathTime(uint32_t cell) const;
+    // Backs the cell off from reading again or gives up on it, what names the step that failed
+    void FailLoad(uint32_t cell, const char* what);
+
+    // Shared by the column tasks of a cell, the last one to finish sets up the BVH
+    struct CellDecode
+    {
+        CellLoad Load{};
+        std::atomic<uint32_t> Remaining{ static_cast<uint32_t>(ObjectColumn::Count) };
+        std::atomic<bool> Failed{ false };
+        std::promise<CellLoad> Result{};
+    };
+
+    struct PendingLoad
+    {
+        uint32_t Cell;
+        uint32_t Buffer; // of m_Reader, released once decoded
+        size_t Bytes; // of the staging store, allocated up front
+        std::shared_ptr<CellDecode> Decode;
+        std::future<CellLoad> Result;
+    };
+
+    static void DecodeColumn(const std::shared_ptr<CellDecode>& decode, const std::shared_ptr<const WorldFile>& file,
+        const uint8_t* block, ObjectColumn column, uint32_t maxObjInNode, BvhTree::SpitMethod method);
+
+    std::shared_ptr<const WorldFile> m_File = nullptr; // shared with pending loads
+    WorldGrid m_Grid{};
+    uint32_t m_MaxCellObjects = 0;
+    std::vector<CellState> m_States{};
+    std::vector<uint32_t> m_ReadBuffers{}; // per cell, the reader's buffer while reading
+    std::vector<bool> m_Prefetching{}; // per cell, reading ahead of the inner radius
+    std::vector<uint8_t> m_Failures{}; // per cell, failed loads so far
+    std::vector<uint32_t> m_RetryUpdates{}; // per cell, the update a failed load may be read again from
+    std::vector<std::pair<DirectX::SimpleMath::Vector3, DirectX::SimpleMath::Vector3>> m_Path{}; // position and forward per step
+    std::vector<std::pair<float, uint32_t>> m_Candidates{}; // priority and cell, reused across updates
+    std::unique_ptr<AsyncReader> m_Reader = nullptr;
+    std::unique_ptr<ThreadPool> m_Workers = nullptr; // after m_Reader, decodes read its buffers
+    std::vector<PendingLoad> m_Pending{};
+    uint32_t m_ReadingCount = 0;
+    uint32_t m_ResidentCount = 0;
+    uint32_t m_FailedReadCount = 0;
+    uint32_t m_FailedCellCount = 0;
+    uint32_t m_UpdateCount = 0;
+    uint32_t m_CancelledCount = 0;
+    uint32_t m_DeferredCount = 0;
+    uint32_t m_PrefetchCount = 0;
+    uint32_t m_DemotedCount = 0;
+
+    float m_InnerRadius = 3000.0f;
+    float m_OuterRadius = 4000.0f;
+    float m_PrefetchHorizon = 2.0f;
+    uint32_t m_MaxObjInNode = 128;
+    BvhTree::SpitMethod m_SplitMethod = BvhTree::SpitMethod::Middle;
+};
@@ -0,0 +1,55 @@
+#include "CullingContext.h"
+
+#include <algorithm>
+#include <cmath>
+#include <directxtk/SimpleMath.h>
+
+using namespace DirectX;
+using namespace SimpleMath;
+
+CullingContext::CullingContext(const Matrix& viewProjection, const Vector3& position, const Vector3& forward,
+    float nearPlane, float farPlane, float projectionScale, float minScreenRadius) :
+    Position{ position.x, position.y, position.z }, Forward{ forward.x, forward.y, forward.z },
+    Near(nearPlane), Far(farPlane), ProjectionScale(projectionScale)
+{
+    if (projectionScale > 0.0f && minScreenRadius > 0.0f)
+        ContributionSq = minScreenRadius * minScreenRadius / (projectionScale * projectionScale);
+
+    // row vectors, clip = v * M, so the clip coordinates are dot products with the columns
+    const Vector4 x(viewProjection._11, viewProjection._21, viewProjection._31, viewProjection._41);
+    const Vector4 y(viewProjection._12, viewProjection._22, viewProjection._32, viewProjection._42);
+    const Vector4 z(viewProjection._13, viewProjection._23, viewProjection._33, viewProjection._43);
+    const Vector4 w(viewProjection._14, viewProjection._24, viewProjection._34, viewProjection._44);
+
+    // inside facing planes -w <= x <= w, -w <= y <= w, 0 <= z <= w, negated to face outward
+    const Vector4 inside[6] = { w + x, w - x, w + y, w - y, z, w - z };
+    for (uint32_t p = 0; p < 6; ++p)
+    {
+        const float length = std::sqrt(inside[p].x * inside[p].x + inside[p].y * inside[p].y + inside[p].z * inside[p].z);
+        const float plane[4] = { -inside[p].x / length, -inside[p].y / length, -inside[p].z / length, -inside[p].w / length };
+        for (uint32_t k = 0; k < 4; ++k)
+        {
+            Planes[p][k] = plane[k];
+            std::fill_n(Splat[p][k], SplatWidth, plane[k]);
+        }
+        for (uint32_t k = 0; k < 3; ++k)
+            AbsNormals[p][k] = std::abs(plane[k]);
+    }
+}
+
+CullingContext::Containment CullingContext::Test(const BoundingSphere& sphere, float maxDrawDistance) const
+{
+    const float dx = sphere.Center.x - Position[0], dy = sphere.Center.y - Position[1], dz = sphere.Center.z - Position[2];
+    const float depth = std::max(dx * Forward[0] + dy * Forward[1] + dz * Forward[2], Near);
+    if (sphere.Radius * sphere.Radius < ContributionSq * depth * depth) return Containment::Disjoint;
+    if (maxDrawDistance < FLT_MAX && dx * dx + dy * dy + dz * dz > maxDrawDistance * maxDrawDistance) return Containment::Disjoint;
+
+    auto result = Containment::Contains;
+    for (const auto& plane : Planes)
+    {
+        const float dist = plane[3] + sphere.Center.x * plane[0] + sphere.Center.y * plane[1] + sphere.Center.z * plane[2];
+        if (dist >= sphere.Radius) return Containment::Disjoint;
+        if (dist > -sphere.Radius) result = Containment::Intersects;
+    }
+    return result;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <cfloat>
+#include <cstdint>
+
+namespace DirectX
+{
+    struct BoundingSphere;
+
+    namespace SimpleMath
+    {
+        struct Matrix;
+        struct Vector3;
+    }
+}
+
+// Frustum data shared by every culling path, built once per view. Plain floats only, so the ISA
+// specific kernels read it without DirectXMath.
+struct CullingContext
+{
+    static constexpr uint32_t SplatWidth = 16; // floats in the widest dispatched batch
+
+    enum class Containment : uint8_t
+    {
+        Disjoint,
+        Intersects,
+        Contains,
+    };
+
+    CullingContext() = default;
+    // Planes come straight from the view projection matrix, D3D clip space with z in [0, 1]
+    // projectionScale converts radius / depth to pixels, spheres under minScreenRadius pixels are culled
+    CullingContext(const DirectX::SimpleMath::Matrix& viewProjection, const DirectX::SimpleMath::Vector3& position,
+        const DirectX::SimpleMath::Vector3& forward, float nearPlane, float farPlane,
+        float projectionScale = 0.0f, float minScreenRadius = 0.0f);
+
+    // contained ranges still need the per object size test when this is on
+    [[nodiscard]] bool HasContributionCulling() const { return ContributionSq > 0.0f; }
+
+    // maxDrawDistance bounds the distance from the camera to any object center inside the sphere
+    [[nodiscard]] Containment Test(const DirectX::BoundingSphere& sphere, float maxDrawDistance = FLT_MAX) const;
+
+    // Normalized and facing outward, a sphere is outside a plane when w + n.c >= r.
+    // Order is left, right, bottom, top, near, far.
+    float Planes[6][4]{};
+    // each plane coefficient repeated across a full batch, loaded instead of broadcast in the kernels
+    alignas(64) float Splat[6][4][SplatWidth]{};
+    // |n| per plane, the AABB extent projection
+    float AbsNormals[6][3]{};
+
+    float Position[3]{};
+    float Forward[3]{};
+    float Near = 0.0f;
+    float Far = 0.0f;
+
+    // A sphere projects to about r / z * ProjectionScale pixels at view depth z, it is culled when
+    // r^2 < ContributionSq * max(z, Near)^2. Depth rather than distance, so spheres off the view axis
+    // aren't dropped early. Safe for BVH nodes too, depth changes no faster than the center moves, so
+    // nothing inside a sphere under the threshold can pass it.
+    float ProjectionScale = 0.0f;
+    float ContributionSq = 0.0f;
+};
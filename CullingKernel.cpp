@@ -0,0 +1,95 @@
+#include "CullingKernel.h"
+
+#include <atomic>
+#include "CullingKernelImpl.h"
+
+namespace
+{
+    struct KernelRegistry
+    {
+        CullingKernelTable Tables[static_cast<int>(CullingIsa::Count)];
+        bool Supported[static_cast<int>(CullingIsa::Count)]{};
+        CullingIsa Detected = CullingIsa::Scalar;
+        std::atomic<CullingIsa> Active = CullingIsa::Scalar;
+
+        KernelRegistry()
+        {
+            const auto available = xsimd::available_architectures();
+            Supported[static_cast<int>(CullingIsa::Scalar)] = true;
+#if defined(_M_ARM64) || defined(__aarch64__)
+            Supported[static_cast<int>(CullingIsa::Neon)] = available.neon64;
+            if (available.neon64) Tables[static_cast<int>(CullingIsa::Neon)] = CullingKernelFactory{}(xsimd::neon64{});
+#else
+            Supported[static_cast<int>(CullingIsa::Sse2)] = available.sse2;
+            Supported[static_cast<int>(CullingIsa::Sse41)] = available.sse4_1;
+            Supported[static_cast<int>(CullingIsa::Avx2)] = available.avx2;
+            Supported[static_cast<int>(CullingIsa::Avx512)] = available.avx512f;
+            if (available.sse2) Tables[static_cast<int>(CullingIsa::Sse2)] = CullingKernelFactory{}(xsimd::sse2{});
+            if (available.sse4_1) Tables[static_cast<int>(CullingIsa::Sse41)] = CullingKernelFactory{}(xsimd::sse4_1{});
+            if (available.avx2) Tables[static_cast<int>(CullingIsa::Avx2)] = CullingKernelFactory{}(xsimd::avx2{});
+            if (available.avx512f) Tables[static_cast<int>(CullingIsa::Avx512)] = CullingKernelFactory{}(xsimd::avx512f{});
+#endif
+            Tables[static_cast<int>(CullingIsa::Scalar)] = CullingKernelImpl::MakeScalarTable();
+
+            // let xsimd pick the best architecture of the list the CPU can run
+            Detected = xsimd::dispatch<CullingArchList>(CullingKernelFactory{})().Isa;
+            Active = Detected;
+        }
+    };
+
+    KernelRegistry& GetRegistry()
+    {
+        static KernelRegistry registry;
+        return registry;
+    }
+
+    // detect at startup rather than on the first culling tick
+    const KernelRegistry& s_Registry = GetRegistry();
+}
+
+const CullingKernelTable& CullingDispatcher::GetKernels()
+{
+    const auto& registry = GetRegistry();
+    return registry.Tables[static_cast<int>(registry.Active.load(std::memory_order_relaxed))];
+}
+
+bool CullingDispatcher::ForceIsa(CullingIsa isa)
+{
+    auto& registry = GetRegistry();
+    if (isa == CullingIsa::Auto) isa = registry.Detected;
+    if (!IsSupported(isa)) return false;
+
+    registry.Active = isa;
+    return true;
+}
+
+CullingIsa CullingDispatcher::GetDetectedIsa()
+{
+    return GetRegistry().Detected;
+}
+
+CullingIsa CullingDispatcher::GetActiveIsa()
+{
+    return GetRegistry().Active;
+}
+
+bool CullingDispatcher::IsSupported(CullingIsa isa)
+{
+    if (isa <= CullingIsa::Auto || isa >= CullingIsa::Count) return false;
+    return GetRegistry().Supported[static_cast<int>(isa)];
+}
+
+const char* CullingDispatcher::GetName(CullingIsa isa)
+{
+    switch (isa)
+    {
+    case CullingIsa::Auto: return "Auto";
+    case CullingIsa::Scalar: return "Scalar";
+    case CullingIsa::Sse2: return "SSE2";
+    case CullingIsa::Sse41: return "SSE4.1";
+    case CullingIsa::Avx2: return "AVX2";
+    case CullingIsa::Avx512: return "AVX-512";
+    case CullingIsa::Neon: return "NEON";
+    default: return "Unknown";
+    }
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include <cstdint>
+#include <xsimd/xsimd.hpp>
+#include "CullingContext.h"
+
+enum class CullingIsa : int
+{
+    Auto = -1,
+    Scalar = 0,
+    Sse2,
+    Sse41,
+    Avx2,
+    Avx512,
+    Neon,
+    Count,
+};
+
+// Kernels only see raw SoA columns, ISA specific translation units never include DirectXMath.
+// All columns of one page share an alignment, the box columns are only read by the box kernels.
+struct CullingColumns
+{
+    const float* PositionX = nullptr;
+    const float* PositionY = nullptr;
+    const float* PositionZ = nullptr;
+    const float* Radius = nullptr;
+    const float* ExtentX = nullptr;
+    const float* ExtentY = nullptr;
+    const float* ExtentZ = nullptr;
+    const float* RotationX = nullptr;
+    const float* RotationY = nullptr;
+    const float* RotationZ = nullptr;
+    const float* RotationW = nullptr;
+    // squared max draw distance per object, null when nothing in the columns has a limit
+    const float* MaxDistanceSq = nullptr;
+
+    // 16 bit sphere columns, position = Origin + q * Step and radius = q * RadiusStep + RadiusBias
+    const uint16_t* QuantizedX = nullptr;
+    const uint16_t* QuantizedY = nullptr;
+    const uint16_t* QuantizedZ = nullptr;
+    const uint16_t* QuantizedRadius = nullptr;
+    float Origin[3]{};
+    float Step[3]{};
+    float RadiusStep = 0.0f;
+    float RadiusBias = 0.0f;
+    // how far a decoded center may be from the real one, draw distances are widened by it
+    float DistancePadding = 0.0f;
+};
+
+// Object rotations in SoA form, columns aligned to the widest batch
+struct RotationColumns
+{
+    const float* X = nullptr;
+    const float* Y = nullptr;
+    const float* Z = nullptr;
+    const float* W = nullptr;
+};
+
+struct CullingKernelTable
+{
+    // Writes baseIndex + i of every visible object to visible and returns how many were written.
+    // Columns may start anywhere. Stores never go past visible + count, so ranges can compact in
+    // place side by side. Box kernels test the bounding sphere first, then the box inside it.
+    using CullFn = uint32_t (*)(const CullingColumns& columns, uint32_t count, const CullingContext& context,
+        uint32_t baseIndex, uint32_t* visible);
+
+    CullingIsa Isa = CullingIsa::Scalar;
+    uint32_t Stride = 1;
+    CullFn CullSpheres = nullptr;
+    CullFn CullAabbs = nullptr; // world aligned extents, p-vertex test
+    CullFn CullObbs = nullptr;  // extents along the axes of the rotation quaternion
+    CullFn CullQuantizedSpheres = nullptr; // half the bytes per object, widened to float in registers
+
+    // Writes the smallest three encoding of every normalized quaternion (InstancePacking.h),
+    // outStride words apart so they land straight in Instance records
+    using PackFn = void (*)(const RotationColumns& columns, uint32_t count, uint32_t* out, uint32_t outStride);
+    PackFn PackRotations = nullptr;
+
+    // Widens the 16 bit sphere columns to floats, for consumers of quantized storage other than culling
+    using DecodeFn = void (*)(const CullingColumns& columns, uint32_t count, float* x, float* y, float* z, float* radius);
+    DecodeFn DecodeSpheres = nullptr;
+};
+
+// xsimd dispatch functor, every architecture is instantiated in its own translation unit
+// compiled with matching instruction set flags (CullingKernel<Isa>.cpp).
+struct CullingKernelFactory
+{
+    template <class Architecture>
+    CullingKernelTable operator()(Architecture) const;
+};
+
+#if defined(_M_ARM64) || defined(__aarch64__)
+using CullingArchList = xsimd::arch_list<xsimd::neon64>;
+extern template CullingKernelTable CullingKernelFactory::operator()<xsimd::neon64>(xsimd::neon64) const;
+#else
+using CullingArchList = xsimd::arch_list<xsimd::avx512f, xsimd::avx2, xsimd::sse4_1, xsimd::sse2>;
+extern template CullingKernelTable CullingKernelFactory::operator()<xsimd::avx512f>(xsimd::avx512f) const;
+extern template CullingKernelTable CullingKernelFactory::operator()<xsimd::avx2>(xsimd::avx2) const;
+extern template CullingKernelTable CullingKernelFactory::operator()<xsimd::sse4_1>(xsimd::sse4_1) const;
+extern template CullingKernelTable CullingKernelFactory::operator()<xsimd::sse2>(xsimd::sse2) const;
+#endif
+
+class CullingDispatcher
+{
+public:
+    // Kernels of the forced ISA if any, otherwise the best one detected at startup
+    [[nodiscard]] static const CullingKernelTable& GetKernels();
+
+    // Auto restores detection, returns false and keeps the current ISA if the CPU lacks the requested one
+    static bool ForceIsa(CullingIsa isa);
+
+    [[nodiscard]] static CullingIsa GetDetectedIsa();
+    [[nodiscard]] static CullingIsa GetActiveIsa();
+    [[nodiscard]] static bool IsSupported(CullingIsa isa);
+    [[nodiscard]] static const char* GetName(CullingIsa isa);
+};
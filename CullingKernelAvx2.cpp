@@ -0,0 +1,4 @@
+// Compiled with /arch:AVX2, see WorldStreaming.vcxproj.
+#include "CullingKernelImpl.h"
+
+template CullingKernelTable CullingKernelFactory::operator()<xsimd::avx2>(xsimd::avx2) const;
@@ -0,0 +1,4 @@
+// Compiled with /arch:AVX512, see WorldStreaming.vcxproj.
+#include "CullingKernelImpl.h"
+
+template CullingKernelTable CullingKernelFactory::operator()<xsimd::avx512f>(xsimd::avx512f) const;
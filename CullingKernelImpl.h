@@ -0,0 +1,474 @@
+#pragma once
+// Only included by the per ISA translation units, see CullingKernel.h. The scalar table is built
+// from the same lane tests with Architecture = void. InstancePacking.h is included for its constants only.
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+#include "CullingKernel.h"
+#include "InstancePacking.h"
+
+#if defined(_M_ARM64) || defined(__aarch64__)
+#include <arm_neon.h>
+#else
+#include <immintrin.h>
+#endif
+
+namespace CullingKernelImpl
+{
+    template <class Architecture>
+    constexpr CullingIsa GetIsa()
+    {
+        if constexpr (std::is_same_v<Architecture, xsimd::avx512f>) return CullingIsa::Avx512;
+        else if constexpr (std::is_same_v<Architecture, xsimd::avx2>) return CullingIsa::Avx2;
+        else if constexpr (std::is_same_v<Architecture, xsimd::sse4_1>) return CullingIsa::Sse41;
+        else if constexpr (std::is_same_v<Architecture, xsimd::sse2>) return CullingIsa::Sse2;
+        else return CullingIsa::Neon;
+    }
+
+    // Lane offsets of the set bits of a 4 bit mask, padded so the packed store is always 4 wide
+    alignas(16) constexpr uint32_t CompactLut[16][4] =
+    {
+        { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 1, 0, 0, 0 }, { 0, 1, 0, 0 },
+        { 2, 0, 0, 0 }, { 0, 2, 0, 0 }, { 1, 2, 0, 0 }, { 0, 1, 2, 0 },
+        { 3, 0, 0, 0 }, { 0, 3, 0, 0 }, { 1, 3, 0, 0 }, { 0, 1, 3, 0 },
+        { 2, 3, 0, 0 }, { 0, 2, 3, 0 }, { 1, 2, 3, 0 }, { 0, 1, 2, 3 },
+    };
+    constexpr uint32_t CompactCount[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+
+    // Appends base + lane of every set lane to out. Raw intrinsics instead of 4 wide xsimd batches, so no
+    // inline function is shared between translation units compiled with different instruction sets.
+    template <class Architecture, uint32_t Lanes>
+    uint32_t Compact(uint64_t mask, uint32_t base, uint32_t* out)
+    {
+#if XSIMD_WITH_AVX512F
+        if constexpr (std::is_same_v<Architecture, xsimd::avx512f>)
+        {
+            const __m512i index = _mm512_add_epi32(_mm512_set1_epi32(static_cast<int>(base)),
+                _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+            _mm512_mask_compressstoreu_epi32(out, static_cast<__mmask16>(mask), index);
+            return static_cast<uint32_t>(_mm_popcnt_u32(static_cast<uint32_t>(mask)));
+        }
+#endif
+        uint32_t n = 0;
+        for (uint32_t lane = 0; lane < Lanes; lane += 4)
+        {
+            const uint32_t nibble = static_cast<uint32_t>(mask >> lane) & 0xF;
+#if defined(_M_ARM64) || defined(__aarch64__)
+            vst1q_u32(out + n, vaddq_u32(vdupq_n_u32(base + lane), vld1q_u32(CompactLut[nibble])));
+#else
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + n), _mm_add_epi32(
+                _mm_set1_epi32(static_cast<int>(base + lane)),
+                _mm_load_si128(reinterpret_cast<const __m128i*>(CompactLut[nibble]))));
+#endif
+            n += CompactCount[nibble];
+        }
+        return n;
+    }
+
+    // Loads one batch of 16 bit values from a batch aligned index and converts them to float
+    template <class Architecture>
+    xsimd::batch<float, Architecture> Widen(const uint16_t* in)
+    {
+#if defined(_M_ARM64) || defined(__aarch64__)
+        return vcvtq_f32_u32(vmovl_u16(vld1_u16(in)));
+#else
+        // each branch only exists in translation units compiled for its instruction set
+#if XSIMD_WITH_AVX512F
+        if constexpr (std::is_same_v<Architecture, xsimd::avx512f>)
+            return _mm512_cvtepi32_ps(_mm512_cvtepu16_epi32(_mm256_load_si256(reinterpret_cast<const __m256i*>(in))));
+        else
+#endif
+#if XSIMD_WITH_AVX2
+        if constexpr (std::is_same_v<Architecture, xsimd::avx2>)
+            return _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_load_si128(reinterpret_cast<const __m128i*>(in))));
+        else
+#endif
+#if XSIMD_WITH_SSE4_1
+        if constexpr (std::is_same_v<Architecture, xsimd::sse4_1>)
+            return _mm_cvtepi32_ps(_mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in))));
+        else
+#endif
+            return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in)), _mm_setzero_si128()));
+#endif
+    }
+
+    // Scalar lane test, templated on the architecture like everything else here so every ISA gets its own copy
+    template <class Architecture, bool Box, bool Oriented, bool Quantized = false>
+    bool IsVisible(const CullingColumns& c, uint32_t i, const CullingContext& context)
+    {
+        float x, y, z, radius;
+        if constexpr (Quantized)
+        {
+            x = c.Origin[0] + static_cast<float>(c.QuantizedX[i]) * c.Step[0];
+            y = c.Origin[1] + static_cast<float>(c.QuantizedY[i]) * c.Step[1];
+            z = c.Origin[2] + static_cast<float>(c.QuantizedZ[i]) * c.Step[2];
+            radius = static_cast<float>(c.QuantizedRadius[i]) * c.RadiusStep + c.RadiusBias;
+        }
+        else
+        {
+            x = c.PositionX[i], y = c.PositionY[i], z = c.PositionZ[i], radius = c.Radius[i];
+        }
+        const auto& planes = context.Planes;
+        const float dx = x - context.Position[0], dy = y - context.Position[1], dz = z - context.Position[2];
+        const float depth = dx * context.Forward[0] + dy * context.Forward[1] + dz * context.Forward[2];
+        const float clamped = depth > context.Near ? depth : context.Near;
+        bool isVisible = radius * radius >= context.ContributionSq * clamped * clamped;
+        if (c.MaxDistanceSq != nullptr)
+        {
+            float distanceSq = dx * dx + dy * dy + dz * dz;
+            if constexpr (Quantized)
+            {
+                // the C function, std::sqrt's float overload is inline and shared like any other
+                const float reach = sqrtf(distanceSq) - c.DistancePadding;
+                distanceSq = reach > 0.0f ? reach * reach : 0.0f;
+            }
+            isVisible &= distanceSq <= c.MaxDistanceSq[i];
+        }
+        for (uint32_t p = 0; p < 6; ++p)
+            isVisible &= planes[p][3] + x * planes[p][0] + y * planes[p][1] + z * planes[p][2] < radius;
+        if constexpr (!Box) return isVisible;
+
+        const float extents[3] = { c.ExtentX[i], c.ExtentY[i], c.ExtentZ[i] };
+        if constexpr (!Oriented)
+        {
+            for (uint32_t p = 0; p < 6; ++p)
+            {
+                const float r = extents[0] * context.AbsNormals[p][0] + extents[1] * context.AbsNormals[p][1] +
+                    extents[2] * context.AbsNormals[p][2];
+                isVisible &= planes[p][3] + x * planes[p][0] + y * planes[p][1] + z * planes[p][2] < r;
+            }
+            return isVisible;
+        }
+
+        // rows of the rotation matrix are the box axes in world space
+        float axes[3][3];
+        {
+            const float qx = c.RotationX[i], qy = c.RotationY[i], qz = c.RotationZ[i], qw = c.RotationW[i];
+            axes[0][0] = 1.0f - 2.0f * (qy * qy + qz * qz);
+            axes[0][1] = 2.0f * (qx * qy + qz * qw);
+            axes[0][2] = 2.0f * (qx * qz - qy * qw);
+            axes[1][0] = 2.0f * (qx * qy - qz * qw);
+            axes[1][1] = 1.0f - 2.0f * (qx * qx + qz * qz);
+            axes[1][2] = 2.0f * (qy * qz + qx * qw);
+            axes[2][0] = 2.0f * (qx * qz + qy * qw);
+            axes[2][1] = 2.0f * (qy * qz - qx * qw);
+            axes[2][2] = 1.0f - 2.0f * (qx * qx + qy * qy);
+        }
+        for (uint32_t p = 0; p < 6; ++p)
+        {
+            float r = 0.0f;
+            for (uint32_t a = 0; a < 3; ++a)
+            {
+                const float d = planes[p][0] * axes[a][0] + planes[p][1] * axes[a][1] + planes[p][2] * axes[a][2];
+                r += extents[a] * (d < 0.0f ? -d : d);
+            }
+            isVisible &= planes[p][3] + x * planes[p][0] + y * planes[p][1] + z * planes[p][2] < r;
+        }
+        return isVisible;
+    }
+
+    template <class Architecture, bool Box, bool Oriented, bool Quantized>
+    uint32_t CullRange(const CullingColumns& columns, uint32_t begin, uint32_t end, const CullingContext& context,
+        uint32_t baseIndex, uint32_t* visible)
+    {
+        uint32_t n = 0;
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            visible[n] = baseIndex + i;
+            n += IsVisible<Architecture, Box, Oriented, Quantized>(columns, i, context);
+        }
+        return n;
+    }
+
+    template <class Architecture, bool Box, bool Oriented, bool Quantized = false>
+    uint32_t CullScalar(const CullingColumns& columns, uint32_t count, const CullingContext& context,
+        uint32_t baseIndex, uint32_t* visible)
+    {
+        return CullRange<Architecture, Box, Oriented, Quantized>(columns, 0, count, context, baseIndex, visible);
+    }
+
+    // The scalar smallest three encoder again, codes match InstancePacking::PackQuaternion. Internal to each
+    // translation unit: the inline one there is shared with baseline code and the linker keeps any one copy.
+    namespace
+    {
+        inline uint32_t QuantizeComponent(float v)
+        {
+            const float q = v * InstancePacking::QuaternionScale + InstancePacking::QuaternionBias + 0.5f;
+            const float top = static_cast<float>(InstancePacking::QuaternionMax);
+            return static_cast<uint32_t>(q < 0.0f ? 0.0f : q > top ? top : q);
+        }
+
+        inline uint32_t PackQuaternion(float x, float y, float z, float w)
+        {
+            const float q[4] = { x, y, z, w };
+            uint32_t largest = 0;
+            float largestAbs = q[0] < 0.0f ? -q[0] : q[0];
+            for (uint32_t k = 1; k < 4; ++k)
+            {
+                const float a = q[k] < 0.0f ? -q[k] : q[k];
+                if (a > largestAbs) largest = k, largestAbs = a;
+            }
+
+            const float sign = q[largest] < 0.0f ? -1.0f : 1.0f;
+            uint32_t packed = largest;
+            for (uint32_t k = 0; k < 4; ++k)
+                if (k != largest) packed = packed << InstancePacking::QuaternionBits | QuantizeComponent(q[k] * sign);
+            return packed;
+        }
+    }
+
+    template <class Architecture>
+    void PackRotationRange(const RotationColumns& c, uint32_t begin, uint32_t end, uint32_t* out, uint32_t outStride)
+    {
+        for (uint32_t i = begin; i < end; ++i)
+            out[static_cast<size_t>(i) * outStride] = PackQuaternion(c.X[i], c.Y[i], c.Z[i], c.W[i]);
+    }
+
+    template <class Architecture>
+    void PackRotationsScalar(const RotationColumns& columns, uint32_t count, uint32_t* out, uint32_t outStride)
+    {
+        PackRotationRange<Architecture>(columns, 0, count, out, outStride);
+    }
+
+    template <class Architecture>
+    void PackRotations(const RotationColumns& c, uint32_t count, uint32_t* out, uint32_t outStride)
+    {
+        using FloatBatch = xsimd::batch<float, Architecture>;
+        using IntBatch = xsimd::batch<int32_t, Architecture>;
+        constexpr uint32_t stride = FloatBatch::size;
+        const uint32_t alignedEnd = count / stride * stride;
+
+        const FloatBatch zero(0.0f), one(1.0f);
+        const FloatBatch scale(InstancePacking::QuaternionScale);
+        const FloatBatch bias(InstancePacking::QuaternionBias + 0.5f);
+        const FloatBatch top(static_cast<float>(InstancePacking::QuaternionMax));
+        const auto quantize = [&](const FloatBatch& v)
+        {
+            return xsimd::batch_cast<int32_t>(xsimd::min(xsimd::max(xsimd::fma(v, scale, bias), zero), top));
+        };
+
+        // codes are computed a batch at a time, then written out per object
+        alignas(64) int32_t packed[stride];
+        for (uint32_t i = 0; i < alignedEnd; i += stride)
+        {
+            auto x = FloatBatch::load_aligned(c.X + i);
+            auto y = FloatBatch::load_aligned(c.Y + i);
+            auto z = FloatBatch::load_aligned(c.Z + i);
+            auto w = FloatBatch::load_aligned(c.W + i);
+
+            // the first largest component is dropped, same tie break as the scalar encoder
+            const auto ax = xsimd::abs(x), ay = xsimd::abs(y), az = xsimd::abs(z), aw = xsimd::abs(w);
+            const auto largest = xsimd::max(xsimd::max(ax, ay), xsimd::max(az, aw));
+            const auto isX = ax == largest;
+            const auto isXy = isX || ay == largest;
+            const auto isXyz = isXy || az == largest;
+
+            const auto dropped = xsimd::select(isX, x, xsimd::select(isXy, y, xsimd::select(isXyz, z, w)));
+            const auto sign = xsimd::select(dropped < zero, -one, one);
+            x *= sign;
+            y *= sign;
+            z *= sign;
+            w *= sign;
+
+            const auto index = xsimd::select(isX, zero, xsimd::select(isXy, one, xsimd::select(isXyz, FloatBatch(2.0f), FloatBatch(3.0f))));
+            const IntBatch code = xsimd::batch_cast<int32_t>(index) << (InstancePacking::QuaternionBits * 3)
+                | quantize(xsimd::select(isX, y, x)) << (InstancePacking::QuaternionBits * 2)
+                | quantize(xsimd::select(isXy, z, y)) << InstancePacking::QuaternionBits
+                | quantize(xsimd::select(isXyz, w, z));
+            code.store_aligned(packed);
+
+            for (uint32_t lane = 0; lane < stride; ++lane)
+                out[static_cast<size_t>(i + lane) * outStride] = static_cast<uint32_t>(packed[lane]);
+        }
+        PackRotationRange<Architecture>(c, alignedEnd, count, out, outStride);
+    }
+
+    template <class Architecture>
+    void DecodeSphereRange(const CullingColumns& c, uint32_t begin, uint32_t end, float* x, float* y, float* z, float* radius)
+    {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            x[i] = c.Origin[0] + static_cast<float>(c.QuantizedX[i]) * c.Step[0];
+            y[i] = c.Origin[1] + static_cast<float>(c.QuantizedY[i]) * c.Step[1];
+            z[i] = c.Origin[2] + static_cast<float>(c.QuantizedZ[i]) * c.Step[2];
+            radius[i] = static_cast<float>(c.QuantizedRadius[i]) * c.RadiusStep + c.RadiusBias;
+        }
+    }
+
+    template <class Architecture>
+    void DecodeSpheresScalar(const CullingColumns& columns, uint32_t count, float* x, float* y, float* z, float* radius)
+    {
+        DecodeSphereRange<Architecture>(columns, 0, count, x, y, z, radius);
+    }
+
+    template <class Architecture>
+    void DecodeSpheres(const CullingColumns& c, uint32_t count, float* x, float* y, float* z, float* radius)
+    {
+        using FloatBatch = xsimd::batch<float, Architecture>;
+        constexpr uint32_t stride = FloatBatch::size;
+
+        // same peeling as Cull, the widening loads need aligned input
+        const uintptr_t address = reinterpret_cast<uintptr_t>(c.QuantizedX) / sizeof(uint16_t);
+        const uint32_t misaligned = static_cast<uint32_t>(address % stride);
+        const uint32_t head = misaligned == 0 ? 0 : stride - misaligned < count ? stride - misaligned : count;
+        const uint32_t alignedEnd = head + (count - head) / stride * stride;
+
+        DecodeSphereRange<Architecture>(c, 0, head, x, y, z, radius);
+        for (uint32_t i = head; i < alignedEnd; i += stride)
+        {
+            (FloatBatch(c.Origin[0]) + Widen<Architecture>(c.QuantizedX + i) * c.Step[0]).store_unaligned(x + i);
+            (FloatBatch(c.Origin[1]) + Widen<Architecture>(c.QuantizedY + i) * c.Step[1]).store_unaligned(y + i);
+            (FloatBatch(c.Origin[2]) + Widen<Architecture>(c.QuantizedZ + i) * c.Step[2]).store_unaligned(z + i);
+            (FloatBatch(c.RadiusBias) + Widen<Architecture>(c.QuantizedRadius + i) * c.RadiusStep).store_unaligned(radius + i);
+        }
+        DecodeSphereRange<Architecture>(c, alignedEnd, count, x, y, z, radius);
+    }
+
+    inline CullingKernelTable MakeScalarTable()
+    {
+        CullingKernelTable table;
+        table.CullSpheres = &CullScalar<void, false, false>;
+        table.CullAabbs = &CullScalar<void, true, false>;
+        table.CullObbs = &CullScalar<void, true, true>;
+        table.CullQuantizedSpheres = &CullScalar<void, false, false, true>;
+        table.PackRotations = &PackRotationsScalar<void>;
+        table.DecodeSpheres = &DecodeSpheresScalar<void>;
+        return table;
+    }
+
+    template <class Architecture, bool Box, bool Oriented, bool Quantized = false>
+    uint32_t Cull(const CullingColumns& c, uint32_t count, const CullingContext& context,
+        uint32_t baseIndex, uint32_t* visible)
+    {
+        using FloatBatch = xsimd::batch<float, Architecture>;
+        using BoolBatch = xsimd::batch_bool<float, Architecture>;
+        constexpr uint32_t stride = FloatBatch::size;
+
+        // ranges may start anywhere, peel a scalar head up to the next aligned batch
+        static_assert(!(Box && Quantized), "quantized columns only hold spheres");
+        const uintptr_t address = Quantized ? reinterpret_cast<uintptr_t>(c.QuantizedX) / sizeof(uint16_t) :
+            reinterpret_cast<uintptr_t>(c.PositionX) / sizeof(float);
+        const uint32_t misaligned = static_cast<uint32_t>(address % stride);
+        const uint32_t head = misaligned == 0 ? 0 : stride - misaligned < count ? stride - misaligned : count;
+        const uint32_t alignedEnd = head + (count - head) / stride * stride;
+
+        uint32_t n = CullRange<Architecture, Box, Oriented, Quantized>(c, 0, head, context, baseIndex, visible);
+
+        for (uint32_t i = head; i < alignedEnd; i += stride)
+        {
+            FloatBatch px, py, pz, radius;
+            if constexpr (Quantized)
+            {
+                px = FloatBatch(c.Origin[0]) + Widen<Architecture>(c.QuantizedX + i) * c.Step[0];
+                py = FloatBatch(c.Origin[1]) + Widen<Architecture>(c.QuantizedY + i) * c.Step[1];
+                pz = FloatBatch(c.Origin[2]) + Widen<Architecture>(c.QuantizedZ + i) * c.Step[2];
+                radius = FloatBatch(c.RadiusBias) + Widen<Architecture>(c.QuantizedRadius + i) * c.RadiusStep;
+            }
+            else
+            {
+                px = FloatBatch::load_aligned(c.PositionX + i);
+                py = FloatBatch::load_aligned(c.PositionY + i);
+                pz = FloatBatch::load_aligned(c.PositionZ + i);
+                radius = FloatBatch::load_aligned(c.Radius + i);
+            }
+
+            // projected size at the view depth and draw distance first, each only when on for the view or columns
+            const auto dx = px - context.Position[0], dy = py - context.Position[1], dz = pz - context.Position[2];
+            BoolBatch isVisible(true);
+            if (context.ContributionSq > 0.0f)
+            {
+                const auto depth = xsimd::max(dx * context.Forward[0] + dy * context.Forward[1] + dz * context.Forward[2],
+                    FloatBatch(context.Near));
+                isVisible = radius * radius >= depth * depth * context.ContributionSq;
+            }
+            if (c.MaxDistanceSq != nullptr)
+            {
+                // a quantized center may be off by the padding, measure to the nearest point it may really be
+                auto distanceSq = dx * dx + dy * dy + dz * dz;
+                if constexpr (Quantized)
+                {
+                    const auto reach = xsimd::max(xsimd::sqrt(distanceSq) - c.DistancePadding, FloatBatch(0.0f));
+                    distanceSq = reach * reach;
+                }
+                isVisible = isVisible && distanceSq <= FloatBatch::load_aligned(c.MaxDistanceSq + i);
+            }
+
+            FloatBatch normals[6][3], dist[6];
+            for (uint32_t p = 0; p < 6; ++p)
+            {
+                // 3 multiply 3 add 1 compare
+                for (uint32_t k = 0; k < 3; ++k)
+                    normals[p][k] = FloatBatch::load_aligned(context.Splat[p][k]);
+                dist[p] = FloatBatch::load_aligned(context.Splat[p][3]);
+                dist[p] += px * normals[p][0];
+                dist[p] += py * normals[p][1];
+                dist[p] += pz * normals[p][2];
+                isVisible = isVisible && dist[p] < radius;
+            }
+
+            // the box lies inside the sphere, only refine batches with a surviving lane
+            if constexpr (Box)
+            {
+                if (xsimd::any(isVisible))
+                {
+                    const auto ex = FloatBatch::load_aligned(c.ExtentX + i);
+                    const auto ey = FloatBatch::load_aligned(c.ExtentY + i);
+                    const auto ez = FloatBatch::load_aligned(c.ExtentZ + i);
+                    if constexpr (Oriented)
+                    {
+                        const auto qx = FloatBatch::load_aligned(c.RotationX + i);
+                        const auto qy = FloatBatch::load_aligned(c.RotationY + i);
+                        const auto qz = FloatBatch::load_aligned(c.RotationZ + i);
+                        const auto qw = FloatBatch::load_aligned(c.RotationW + i);
+                        const auto xx = qx * qx, yy = qy * qy, zz = qz * qz;
+                        const auto xy = qx * qy, xz = qx * qz, yz = qy * qz;
+                        const auto xw = qx * qw, yw = qy * qw, zw = qz * qw;
+                        const FloatBatch one(1.0f), two(2.0f);
+                        const FloatBatch axes[3][3] =
+                        {
+                            { one - two * (yy + zz), two * (xy + zw), two * (xz - yw) },
+                            { two * (xy - zw), one - two * (xx + zz), two * (yz + xw) },
+                            { two * (xz + yw), two * (yz - xw), one - two * (xx + yy) },
+                        };
+                        for (uint32_t p = 0; p < 6; ++p)
+                        {
+                            const auto r =
+                                ex * xsimd::abs(axes[0][0] * normals[p][0] + axes[0][1] * normals[p][1] + axes[0][2] * normals[p][2]) +
+                                ey * xsimd::abs(axes[1][0] * normals[p][0] + axes[1][1] * normals[p][1] + axes[1][2] * normals[p][2]) +
+                                ez * xsimd::abs(axes[2][0] * normals[p][0] + axes[2][1] * normals[p][1] + axes[2][2] * normals[p][2]);
+                            isVisible = isVisible && dist[p] < r;
+                        }
+                    }
+                    else
+                    {
+                        // distance of the p-vertex, the corner furthest along the plane normal
+                        for (uint32_t p = 0; p < 6; ++p)
+                        {
+                            const auto r = ex * context.AbsNormals[p][0] + ey * context.AbsNormals[p][1] +
+                                ez * context.AbsNormals[p][2];
+                            isVisible = isVisible && dist[p] < r;
+                        }
+                    }
+                }
+            }
+            n += Compact<Architecture, stride>(isVisible.mask(), baseIndex + i, visible + n);
+        }
+
+        return n + CullRange<Architecture, Box, Oriented, Quantized>(c, alignedEnd, count, context, baseIndex, visible + n);
+    }
+}
+
+template <class Architecture>
+CullingKernelTable CullingKernelFactory::operator()(Architecture) const
+{
+    CullingKernelTable table;
+    table.Isa = CullingKernelImpl::GetIsa<Architecture>();
+    table.Stride = xsimd::batch<float, Architecture>::size;
+    table.CullSpheres = &CullingKernelImpl::Cull<Architecture, false, false>;
+    table.CullAabbs = &CullingKernelImpl::Cull<Architecture, true, false>;
+    table.CullObbs = &CullingKernelImpl::Cull<Architecture, true, true>;
+    table.CullQuantizedSpheres = &CullingKernelImpl::Cull<Architecture, false, false, true>;
+    table.PackRotations = &CullingKernelImpl::PackRotations<Architecture>;
+    table.DecodeSpheres = &CullingKernelImpl::DecodeSpheres<Architecture>;
+    return table;
+}
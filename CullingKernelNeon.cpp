@@ -0,0 +1,6 @@
+// Compiled with the ARM64 baseline, empty on x86 targets, see WorldStreaming.vcxproj.
+#include "CullingKernelImpl.h"
+
+#if defined(_M_ARM64) || defined(__aarch64__)
+template CullingKernelTable CullingKernelFactory::operator()<xsimd::neon64>(xsimd::neon64) const;
+#endif
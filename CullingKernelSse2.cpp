@@ -0,0 +1,4 @@
+// Compiled with the baseline instruction set, see WorldStreaming.vcxproj.
+#include "CullingKernelImpl.h"
+
+template CullingKernelTable CullingKernelFactory::operator()<xsimd::sse2>(xsimd::sse2) const;
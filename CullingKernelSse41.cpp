@@ -0,0 +1,4 @@
+// Compiled with __SSE4_1__ defined, MSVC has no dedicated /arch switch for it, see WorldStreaming.vcxproj.
+#include "CullingKernelImpl.h"
+
+template CullingKernelTable CullingKernelFactory::operator()<xsimd::sse4_1>(xsimd::sse4_1) const;
@@ -0,0 +1,316 @@
+#include "CullingSoa.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include "GlobalContext.h"
+
+using namespace DirectX;
+using namespace SimpleMath;
+
+CullingSoa::Page::Page() : FloatChunk(),
+    PositionX(FloatChunk[0]), PositionY(FloatChunk[1]), PositionZ(FloatChunk[2]), Radius(FloatChunk[3]),
+    MaxDistanceSq(FloatChunk[4])
+{
+    std::fill_n(MaxDistanceSq, PageCapacity, std::numeric_limits<float>::infinity());
+}
+
+void CullingSoa::Page::AllocateBoxes()
+{
+    BoxChunk = std::make_unique<AlignedVector<float, PageCapacity, NBoxField, Alignment>>();
+    auto& box = *BoxChunk;
+    for (uint32_t i = 0; i < PageCapacity; ++i)
+    {
+        box[0][i] = box[1][i] = box[2][i] = Radius[i];
+        box[3][i] = box[4][i] = box[5][i] = 0.0f;
+        box[6][i] = 1.0f;
+    }
+}
+
+CullingColumns CullingSoa::Page::GetColumns(uint32_t offset) const
+{
+    CullingColumns columns;
+    columns.PositionX = PositionX + offset;
+    columns.PositionY = PositionY + offset;
+    columns.PositionZ = PositionZ + offset;
+    columns.Radius = Radius + offset;
+    if (LimitedCount > 0) columns.MaxDistanceSq = MaxDistanceSq + offset;
+    if (BoxChunk != nullptr)
+    {
+        auto& box = *BoxChunk;
+        columns.ExtentX = box[0] + offset;
+        columns.ExtentY = box[1] + offset;
+        columns.ExtentZ = box[2] + offset;
+        columns.RotationX = box[3] + offset;
+        columns.RotationY = box[4] + offset;
+        columns.RotationZ = box[5] + offset;
+        columns.RotationW = box[6] + offset;
+    }
+    return columns;
+}
+
+void CullingSoa::Page::Quantize(uint32_t count)
+{
+    if (QuantizedChunk == nullptr) QuantizedChunk = std::make_unique<AlignedVector<uint16_t, PageCapacity, NQuantizedField, Alignment>>();
+    auto& q = *QuantizedChunk;
+
+    const float* positions[3] = { PositionX, PositionY, PositionZ };
+    float diagonal = 0.0f;
+    for (uint32_t axis = 0; axis < 3; ++axis)
+    {
+        const auto [min, max] = std::minmax_element(positions[axis], positions[axis] + count);
+        Origin[axis] = *min;
+        Step[axis] = std::max((*max - *min) / UINT16_MAX, std::numeric_limits<float>::min());
+        diagonal += Step[axis] * Step[axis];
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const float offset = std::round((positions[axis][i] - Origin[axis]) / Step[axis]);
+            q[axis][i] = static_cast<uint16_t>(std::clamp(offset, 0.0f, static_cast<float>(UINT16_MAX)));
+        }
+    }
+
+    // rounding moves a center by at most half a step per axis, one more radius step absorbs float error
+    RadiusStep = std::max(*std::max_element(Radius, Radius + count) / UINT16_MAX, std::numeric_limits<float>::min());
+    RadiusBias = 0.5f * std::sqrt(diagonal) + RadiusStep;
+    for (uint32_t i = 0; i < count; ++i)
+        q[3][i] = static_cast<uint16_t>(std::min(std::ceil(Radius[i] / RadiusStep), static_cast<float>(UINT16_MAX)));
+    QuantizedDirty = false;
+}
+
+CullingColumns CullingSoa::Page::GetQuantizedColumns(uint32_t offset) const
+{
+    auto& q = *QuantizedChunk;
+    CullingColumns columns;
+    columns.QuantizedX = q[0] + offset;
+    columns.QuantizedY = q[1] + offset;
+    columns.QuantizedZ = q[2] + offset;
+    columns.QuantizedRadius = q[3] + offset;
+    if (LimitedCount > 0) columns.MaxDistanceSq = MaxDistanceSq + offset;
+    std::copy_n(Origin, 3, columns.Origin);
+    std::copy_n(Step, 3, columns.Step);
+    columns.RadiusStep = RadiusStep;
+    columns.RadiusBias = RadiusBias;
+    // the bias covers the rounding of the center, and float error on top
+    columns.DistancePadding = RadiusBias;
+    return columns;
+}
+
+void CullingSoa::Resize(uint32_t size)
+{
+    const uint32_t pageCount = (size + PageCapacity - 1) / PageCapacity;
+    m_Pages.resize(pageCount);
+    for (auto& page : m_Pages)
+        if (page == nullptr) page = std::make_unique<Page>();
+    if (!m_Pages.empty()) m_Pages.back()->QuantizedDirty = true;
+    m_Size = size;
+}
+
+size_t CullingSoa::GetMemoryUsage() const
+{
+    size_t bytes = m_Pages.capacity() * sizeof(std::unique_ptr<Page>);
+    for (const auto& page : m_Pages)
+    {
+        bytes += sizeof(Page) + PageCapacity * NFloatField * sizeof(float);
+        if (page->BoxChunk != nullptr) bytes += PageCapacity * NBoxField * sizeof(float);
+        if (page->QuantizedChunk != nullptr) bytes += PageCapacity * NQuantizedField * sizeof(uint16_t);
+    }
+    return bytes;
+}
+
+void CullingSoa::SetDrawDistance(uint32_t index, float maxDistance)
+{
+    assert(index < m_Size);
+
+    Page& page = *m_Pages[index / PageCapacity];
+    const uint32_t i = index % PageCapacity;
+    const float distanceSq = maxDistance < std::numeric_limits<float>::max() ?
+        maxDistance * maxDistance : std::numeric_limits<float>::infinity();
+    page.LimitedCount -= page.MaxDistanceSq[i] != std::numeric_limits<float>::infinity();
+    page.LimitedCount += distanceSq != std::numeric_limits<float>::infinity();
+    page.MaxDistanceSq[i] = distanceSq;
+}
+
+void CullingSoa::SetQuantized(bool quantized)
+{
+    m_Quantized = quantized;
+    if (m_Quantized) Quantize();
+}
+
+void CullingSoa::Quantize()
+{
+    if (!m_Quantized) return;
+
+    for (uint32_t p = 0; p < m_Pages.size(); ++p)
+        if (m_Pages[p]->QuantizedDirty)
+            m_Pages[p]->Quantize(std::min(PageCapacity, m_Size - p * PageCapacity));
+}
+
+void CullingSoa::Set(uint32_t index, const BoundingSphere& sphere)
+{
+    assert(index < m_Size);
+
+    Page& page = *m_Pages[index / PageCapacity];
+    const uint32_t i = index % PageCapacity;
+    page.PositionX[i] = sphere.Center.x;
+    page.PositionY[i] = sphere.Center.y;
+    page.PositionZ[i] = sphere.Center.z;
+    page.Radius[i] = sphere.Radius;
+    page.QuantizedDirty = true;
+
+    page.AabbCount -= page.Kinds[i] == static_cast<uint8_t>(BoundKind::Aabb);
+    page.ObbCount -= page.Kinds[i] == static_cast<uint8_t>(BoundKind::Obb);
+    page.Kinds[i] = static_cast<uint8_t>(BoundKind::Sphere);
+    if (page.BoxChunk == nullptr) return;
+
+    auto& box = *page.BoxChunk;
+    box[0][i] = box[1][i] = box[2][i] = sphere.Radius;
+    box[3][i] = box[4][i] = box[5][i] = 0.0f;
+    box[6][i] = 1.0f;
+}
+
+void CullingSoa::Set(uint32_t index, const BoundingSphere& sphere, const BoundingOrientedBox& obb, BoundKind kind)
+{
+    Set(index, sphere);
+    if (kind == BoundKind::Sphere) return;
+
+    Page& page = *m_Pages[index / PageCapacity];
+    const uint32_t i = index % PageCapacity;
+    if (page.BoxChunk == nullptr) page.AllocateBoxes();
+
+    // the kernels test boxes around the sphere center
+    auto& box = *page.BoxChunk;
+    assert(Vector3::Distance(obb.Center, sphere.Center) < 1e-3f * sphere.Radius + 1e-3f);
+    Vector3 extents = obb.Extents;
+    Quaternion rotation = obb.Orientation;
+    if (kind == BoundKind::Aabb)
+    {
+        // extents of the world aligned box enclosing the oriented one, |R| * e
+        const Matrix r = Matrix::CreateFromQuaternion(rotation);
+        extents = Vector3(
+            std::abs(r._11) * extents.x + std::abs(r._21) * extents.y + std::abs(r._31) * extents.z,
+            std::abs(r._12) * extents.x + std::abs(r._22) * extents.y + std::abs(r._32) * extents.z,
+            std::abs(r._13) * extents.x + std::abs(r._23) * extents.y + std::abs(r._33) * extents.z);
+        rotation = Quaternion::Identity;
+    }
+    box[0][i] = extents.x;
+    box[1][i] = extents.y;
+    box[2][i] = extents.z;
+    box[3][i] = rotation.x;
+    box[4][i] = rotation.y;
+    box[5][i] = rotation.z;
+    box[6][i] = rotation.w;
+
+    page.Kinds[i] = static_cast<uint8_t>(kind);
+    page.AabbCount += kind == BoundKind::Aabb;
+    page.ObbCount += kind == BoundKind::Obb;
+}
+
+CullingSoa::Schedule CullingSoa::Split(const std::vector<BvhObjectRange>& ranges) const
+{
+    // split ranges on page boundaries and into pieces no larger than one task's share
+    uint32_t total = 0;
+    for (const auto& range : ranges) total += range.Count;
+    Schedule schedule;
+    schedule.TaskCount = std::max(1u, std::min(static_cast<uint32_t>(g_Context.ThreadCount), total / MinObjectsPerTask));
+    const uint32_t pieceSize = std::max(1u, (total + schedule.TaskCount - 1) / schedule.TaskCount);
+
+    auto& pieces = schedule.Pieces;
+    pieces.reserve(ranges.size() + total / PageCapacity + schedule.TaskCount);
+    for (const auto& range : ranges)
+    {
+        const uint32_t end = std::min(range.Offset + range.Count, m_Size);
+        for (uint32_t begin = range.Offset; begin < end;)
+        {
+            const uint32_t pageEnd = (begin / PageCapacity + 1) * PageCapacity;
+            const uint32_t pieceEnd = std::min({ begin + pieceSize, pageEnd, end });
+            pieces.push_back({ begin, pieceEnd, range.Contained });
+            begin = pieceEnd;
+        }
+    }
+
+    // contiguous runs of pieces with roughly pieceSize objects per task, so each task walks its own pages
+    auto& taskFirstPiece = schedule.TaskFirstPiece;
+    taskFirstPiece.assign(schedule.TaskCount + 1, static_cast<uint32_t>(pieces.size()));
+    taskFirstPiece[0] = 0;
+    for (uint32_t i = 0, task = 1, accumulated = 0; i < pieces.size() && task < schedule.TaskCount; ++i)
+    {
+        accumulated += pieces[i].End - pieces[i].Begin;
+        if (accumulated >= task * pieceSize) taskFirstPiece[task++] = i + 1;
+    }
+    return schedule;
+}
+
+uint32_t CullingSoa::CullPiece(const CullingContext& context, const Piece& piece, uint32_t* visible) const
+{
+    const Page& page = *m_Pages[piece.Begin / PageCapacity];
+    const uint32_t local = piece.Begin % PageCapacity;
+    // contained pieces still need the per object size and distance tests
+    if (piece.Contained && !context.HasContributionCulling() && page.LimitedCount == 0)
+    {
+        std::iota(visible, visible + piece.End - piece.Begin, piece.Begin);
+        return piece.End - piece.Begin;
+    }
+
+    // the widest test any object of the page needs, AABB lanes are OBBs with identity rotation
+    const auto& kernels = CullingDispatcher::GetKernels();
+    const bool hasBoxes = page.ObbCount > 0 || page.AabbCount > 0;
+    if (m_Quantized && !hasBoxes && !page.QuantizedDirty)
+    {
+        return kernels.CullQuantizedSpheres(page.GetQuantizedColumns(local),
+            piece.End - piece.Begin, context, piece.Begin, visible);
+    }
+    const auto cull = page.ObbCount > 0 ? kernels.CullObbs :
+        page.AabbCount > 0 ? kernels.CullAabbs : kernels.CullSpheres;
+    return cull(page.GetColumns(local), piece.End - piece.Begin, context, piece.Begin, visible);
+}
+
+std::vector<uint32_t> CullingSoa::TickCulling(const CullingContext& context,
+    const std::vector<BvhObjectRange>& ranges) const
+{
+    std::vector<uint32_t> visible;
+    TickCulling(context, ranges, [&](uint32_t total) { visible.resize(total); },
+        [&](const uint32_t* indices, uint32_t count, uint32_t offset)
+        {
+            std::copy_n(indices, count, visible.data() + offset);
+        });
+    return visible;
+}
+
+uint32_t CullingSoa::TickCulling(const CullingContext& context, const std::vector<BvhObjectRange>& ranges,
+    const ResizeFn& resize, const EmitFn& emit) const
+{
+    const auto schedule = Split(ranges);
+    const auto& pieces = schedule.Pieces;
+    const auto& taskFirstPiece = schedule.TaskFirstPiece;
+
+    // every piece compacts its visible indices into its own part of a buffer of this call, at most one per
+    // object, so views culling the same mirror at once don't share anything they write
+    std::vector<uint32_t> firsts(pieces.size() + 1, 0);
+    for (uint32_t i = 0; i < pieces.size(); ++i)
+        firsts[i + 1] = firsts[i] + pieces[i].End - pieces[i].Begin;
+    std::vector<uint32_t> culled(firsts[pieces.size()]);
+
+    std::vector<uint32_t> offsets(pieces.size() + 1, 0);
+    g_Context.ParallelFor(schedule.TaskCount, [&](size_t task)
+    {
+        for (uint32_t i = taskFirstPiece[task]; i < taskFirstPiece[task + 1]; ++i)
+            offsets[i + 1] = CullPiece(context, pieces[i], culled.data() + firsts[i]);
+    });
+
+    // pieces are in object order, a prefix sum over them places every piece's output
+    for (uint32_t i = 0; i < pieces.size(); ++i)
+        offsets[i + 1] += offsets[i];
+
+    resize(offsets[pieces.size()]);
+    g_Context.ParallelFor(schedule.TaskCount, [&](size_t task)
+    {
+        for (uint32_t i = taskFirstPiece[task]; i < taskFirstPiece[task + 1]; ++i)
+        {
+            if (offsets[i + 1] > offsets[i])
+                emit(culled.data() + firsts[i], offsets[i + 1] - offsets[i], offsets[i]);
+        }
+    });
+    return offsets[pieces.size()];
+}
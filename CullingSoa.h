@@ -1,12 +1,29 @@
 #pragma once
+#include <functional>
+#include <memory>
+#include <vector>
 #include "AlignedVector.h"
+#include "BvhTree.h"
+#include "CullingKernel.h"
 #include <directxtk/SimpleMath.h>
 
-template <uint32_t Capacity>
+// Sphere bounds are always kept, boxes refine them for objects whose geometry is far from round
+enum class BoundKind : uint8_t
+{
+    Sphere,
+    Aabb, // world axis aligned box around the oriented one, cheaper test
+    Obb,
+};
+
+// Persistent mirror of object bounds, index aligned with the objects it is built from,
+// so BVH leaf ranges are culled in place without gathering.
+// Storage grows in fixed pages sized to stay cache resident while a page is culled.
 class CullingSoa
 {
 public:
-    CullingSoa();
+    static constexpr uint32_t PageCapacity = 1 << 11; // 32 KB of bounds per page
+
+    CullingSoa() = default;
     ~CullingSoa() = default;
 
     CullingSoa(const CullingSoa&) = delete;
@@ -14,180 +31,96 @@ public:
     CullingSoa& operator=(const CullingSoa&) = delete;
     CullingSoa& operator=(CullingSoa&&) = delete;
 
-    template <class Architecture>
-    std::vector<uint32_t> TickCulling(const std::vector<DirectX::BoundingSphere>& data,
-        const DirectX::BoundingFrustum& frustum);
-
-    // scalar version
-    std::vector<uint32_t> TickCulling(const std::vector<DirectX::BoundingSphere>& data,
-        const DirectX::BoundingFrustum& frustum);
+    void Resize(uint32_t size);
+    void Set(uint32_t index, const DirectX::BoundingSphere& sphere);
+    // box must lie inside sphere, the kernels only refine objects the sphere test keeps
+    void Set(uint32_t index, const DirectX::BoundingSphere& sphere, const DirectX::BoundingOrientedBox& box, BoundKind kind);
+    [[nodiscard]] uint32_t GetSize() const { return m_Size; }
+    [[nodiscard]] uint32_t GetPageCount() const { return static_cast<uint32_t>(m_Pages.size()); }
+    [[nodiscard]] size_t GetMemoryUsage() const;
+
+    // infinity for no limit, measured from the camera to the sphere center
+    void SetDrawDistance(uint32_t index, float maxDistance);
+
+    // 16 bit sphere columns relative to a per page origin for bandwidth bound scans, bounds are rounded up
+    // so quantized culling only keeps more objects. Pages with boxes or unquantized changes use floats.
+    void SetQuantized(bool quantized);
+    [[nodiscard]] bool IsQuantized() const { return m_Quantized; }
+    // Requantizes pages changed by Set since the last call
+    void Quantize();
+
+    // kernels are picked at runtime by CullingDispatcher, contained ranges skip the plane tests,
+    // pages without boxes run the sphere kernel. Only reads the mirror, several views may cull it at once.
+    [[nodiscard]] std::vector<uint32_t> TickCulling(const CullingContext& context,
+        const std::vector<BvhObjectRange>& ranges) const;
+
+    // For callers writing their own records. Every piece is culled in place first, then resize(total) runs on
+    // the calling thread and emit(visible, count, offset) once per piece, split over tasks like the culling.
+    // offset is where the piece's first record goes, records end up in object order. Returns the total.
+    using ResizeFn = std::function<void(uint32_t total)>;
+    using EmitFn = std::function<void(const uint32_t* visible, uint32_t count, uint32_t offset)>;
+    uint32_t TickCulling(const CullingContext& context, const std::vector<BvhObjectRange>& ranges,
+        const ResizeFn& resize, const EmitFn& emit) const;
 
 private:
-    void Clear();
-    void Push(const DirectX::BoundingSphere& sphere);
-    void Push(const std::vector<DirectX::BoundingSphere>& spheres);
-
-    [[nodiscard]] std::vector<uint32_t> ComputeScalar(const DirectX::BoundingFrustum& frustum) const;
-    template <class Architecture>
-    [[nodiscard]] std::vector<uint32_t> ComputeVector(const DirectX::BoundingFrustum& frustum) const;
-
-    static constexpr uint32_t NFloatField = 4;
-    static constexpr uint32_t NBoolField = 1;
-    static constexpr uint32_t Alignment = xsimd::avx2::alignment(); // bigger alignment for new arch
-
-    AlignedVector<float, Capacity, NFloatField, Alignment> m_FloatChunk;
-    AlignedVector<bool, Capacity, NBoolField, Alignment> m_BoolChunk;
-    uint32_t m_Size = 0;
-
-    float* const m_PositionX;
-    float* const m_PositionY;
-    float* const m_PositionZ;
-    float* const m_Radius;
-    bool*  const m_IsVisible;
-};
-
-template <uint32_t Capacity>
-CullingSoa<Capacity>::CullingSoa() : m_FloatChunk(), m_BoolChunk(),
-    m_PositionX(m_FloatChunk[0]), m_PositionY(m_FloatChunk[1]), m_PositionZ(m_FloatChunk[2]), m_Radius(m_FloatChunk[3]), m_IsVisible(m_BoolChunk[0])
-{
-}
-
-template <uint32_t Capacity>
-void CullingSoa<Capacity>::Push(const DirectX::BoundingSphere& sphere)
-{
-    if (m_Size >= Capacity) return;
+    static constexpr uint32_t NFloatField = 5;
+    static constexpr uint32_t NBoxField = 7; // extents and rotation
+    static constexpr uint32_t NQuantizedField = 4;
+    static constexpr uint32_t MinObjectsPerTask = 2048; // below this the pool round trip costs more than it saves
+    static constexpr uint32_t Alignment = xsimd::avx512f::alignment(); // widest dispatched arch
 
-    m_PositionX[m_Size] = sphere.Center.x;
-    m_PositionY[m_Size] = sphere.Center.y;
-    m_PositionZ[m_Size] = sphere.Center.z;
-    m_Radius[m_Size] = sphere.Radius;
-    m_Size++;
-}
-
-template <uint32_t Capacity>
-void CullingSoa<Capacity>::Push(const std::vector<DirectX::BoundingSphere>& spheres)
-{
-    for (const auto& sphere : spheres) Push(sphere);
-}
-
-template <uint32_t Capacity>
-std::vector<uint32_t> CullingSoa<Capacity>::ComputeScalar(const DirectX::BoundingFrustum& frustum) const
-{
-    DirectX::XMVECTOR vs[6];
-    frustum.GetPlanes(vs, vs + 1, vs + 2, vs + 3, vs + 4, vs + 5);
-    DirectX::SimpleMath::Plane planes[6];
-    for (uint32_t i = 0; i < 6; ++i)
+    struct Page
     {
-        planes[i] = DirectX::SimpleMath::Plane(vs[i]);
-    }
+        Page();
+
+        AlignedVector<float, PageCapacity, NFloatField, Alignment> FloatChunk;
+
+        float* const PositionX;
+        float* const PositionY;
+        float* const PositionZ;
+        float* const Radius;
+        float* const MaxDistanceSq;
+
+        // box columns are allocated on the first box, sphere lanes of a box page hold (r, r, r) and identity
+        void AllocateBoxes();
+        [[nodiscard]] CullingColumns GetColumns(uint32_t offset) const;
+        void Quantize(uint32_t count);
+        [[nodiscard]] CullingColumns GetQuantizedColumns(uint32_t offset) const;
+
+        std::unique_ptr<AlignedVector<float, PageCapacity, NBoxField, Alignment>> BoxChunk{};
+        uint8_t Kinds[PageCapacity]{};
+        uint32_t AabbCount = 0;
+        uint32_t ObbCount = 0;
+        uint32_t LimitedCount = 0; // objects with a finite draw distance
+
+        std::unique_ptr<AlignedVector<uint16_t, PageCapacity, NQuantizedField, Alignment>> QuantizedChunk{};
+        float Origin[3]{};
+        float Step[3]{};
+        float RadiusStep = 0.0f;
+        float RadiusBias = 0.0f;
+        bool QuantizedDirty = true;
+    };
 
-    for (uint32_t i = 0; i < m_Size; ++i)
+    // part of a range inside a single page
+    struct Piece
     {
-        bool isVisible = true;
-        for (const auto& plane : planes)
-            isVisible = isVisible && plane.w + m_PositionX[i] * plane.x + m_PositionY[i] * plane.y + m_PositionZ[i] * plane.z < m_Radius[i];
-        m_IsVisible[i] = isVisible;
-    }
-
-    std::vector<uint32_t> result;
-    for (uint32_t i = 0; i < m_Size; ++i)
-    {
-        if (m_IsVisible[i]) result.push_back(i);
-    }
-    return result;
-}
-
-template <uint32_t Capacity>
-template <class Architecture>
-std::vector<uint32_t> CullingSoa<Capacity>::ComputeVector(const DirectX::BoundingFrustum& frustum) const
-{
-    DirectX::XMVECTOR vs[6];
-    frustum.GetPlanes(vs, vs + 1, vs + 2, vs + 3, vs + 4, vs + 5);
-    DirectX::SimpleMath::Plane planes[6];
-    for (uint32_t i = 0; i < 6; ++i)
-    {
-        planes[i] = DirectX::SimpleMath::Plane(vs[i]);
-    }
-
-    using FloatBatch = xsimd::batch<float, Architecture>;
-    using BoolBatch = xsimd::batch_bool<float, Architecture>;
-    const uint32_t stride = FloatBatch::size;
+        uint32_t Begin;
+        uint32_t End;
+        bool Contained;
+    };
 
-    auto dispatch = [stride, &planes, this](uint32_t from, uint32_t length)
+    struct Schedule
     {
-        const uint32_t alignedSize = length - length % stride;
-
-        for (uint32_t i = from; i < from + alignedSize; i += stride)
-        {
-            BoolBatch visible(true);
-            for (const auto& plane : planes)
-            {
-                // 3 multiply 3 add 1 compare
-                FloatBatch dist(plane.w);
-                dist += FloatBatch::load_aligned(m_PositionX + i) * plane.x;
-                dist += FloatBatch::load_aligned(m_PositionY + i) * plane.y;
-                dist += FloatBatch::load_aligned(m_PositionZ + i) * plane.z;
-                visible = visible && dist < FloatBatch::load_aligned(m_Radius + i);
-            }
-            visible.store_aligned(m_IsVisible + i);
-        }
-
-        for (uint32_t i = from + alignedSize; i < from + length; ++i)
-        {
-            bool visible = true;
-            for (const auto& plane : planes)
-                visible &= plane.w + m_PositionX[i] * plane.x + m_PositionY[i] * plane.y + m_PositionZ[i] * plane.z < m_Radius[i];
-            m_IsVisible[i] = visible;
-        }
+        std::vector<Piece> Pieces;
+        std::vector<uint32_t> TaskFirstPiece;
+        uint32_t TaskCount = 1;
     };
 
-    // multi-threading
-    //ThreadPool* pool = g_Context.Pool.get();
-    //const auto threadCount = g_Context.ThreadCount;
-    //std::vector<std::future<void>> futures;
-    //const int groupLen = m_Size / threadCount;
-
-    //for (int i = 0; i < threadCount; ++i)
-    //    futures.emplace_back(
-    //        pool->enqueue(dispatch, i * groupLen, groupLen));
-
-    //for (uint32_t i = 0; i < threadCount; ++i)
-    //    futures[i].wait();
-
-    dispatch(0, m_Size);
-
-    std::vector<uint32_t> visible;
-    for (uint32_t i = 0; i < m_Size; ++i)
-        if (m_IsVisible[i])
-            visible.push_back(i);
-
-    return visible;
+    [[nodiscard]] Schedule Split(const std::vector<BvhObjectRange>& ranges) const;
+    // Compacts the visible indices of piece into visible, room for one per object, and returns how many
+    uint32_t CullPiece(const CullingContext& context, const Piece& piece, uint32_t* visible) const;
 
-}
-
-template <uint32_t Capacity>
-std::vector<uint32_t> CullingSoa<Capacity>::TickCulling(const std::vector<DirectX::BoundingSphere>& data,
-    const DirectX::BoundingFrustum& frustum)
-{
-    Clear();
-    Push(data);
-
-    return ComputeScalar(frustum);
-}
-
-template <uint32_t Capacity>
-template <class Architecture>
-std::vector<uint32_t> CullingSoa<Capacity>::TickCulling(const std::vector<DirectX::BoundingSphere>& data,
-    const DirectX::BoundingFrustum& frustum)
-{
-    Clear();
-    Push(data);
-
-    return ComputeVector<Architecture>(frustum);
-}
-
-template <uint32_t Capacity>
-void CullingSoa<Capacity>::Clear()
-{
-    m_Size = 0;
-}
+    std::vector<std::unique_ptr<Page>> m_Pages{};
+    uint32_t m_Size = 0;
+    bool m_Quantized = false;
+};
@@ -0,0 +1,26 @@
+#include "CullingStrategy.h"
+
+#include <algorithm>
+
+bool CullingCostModel::PreferScan(uint32_t nodeCount, uint32_t objectCount) const
+{
+    // traversal touches roughly the visible share of the nodes and still tests the visible share of the
+    // objects, scanning tests all of them: scan wins once the node work outweighs the objects it skips
+    const float traversal = m_NodeCostNs * static_cast<float>(nodeCount) * m_VisibleFraction;
+    const float skipped = m_ObjectCostNs * static_cast<float>(objectCount) * (1.0f - m_VisibleFraction);
+    return traversal > skipped;
+}
+
+void CullingCostModel::Update(uint32_t nodesVisited, float traversalMs, uint32_t objectsTested, float scanMs,
+    uint32_t objectsCrossing, uint32_t visibleCrossing)
+{
+    if (nodesVisited > 0)
+        m_NodeCostNs += Smoothing * (traversalMs * 1e6f / static_cast<float>(nodesVisited) - m_NodeCostNs);
+    if (objectsTested > 0)
+        m_ObjectCostNs += Smoothing * (scanMs * 1e6f / static_cast<float>(objectsTested) - m_ObjectCostNs);
+    if (objectsCrossing > 0)
+    {
+        const float fraction = std::min(1.0f, static_cast<float>(visibleCrossing) / static_cast<float>(objectsCrossing));
+        m_VisibleFraction += Smoothing * (fraction - m_VisibleFraction);
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+
+enum class CullingStrategy : int
+{
+    Auto = -1, // per BVH subtree, by CullingCostModel
+    Bvh = 0,
+    BruteForce,
+    Count,
+};
+
+// What the last culling tick did, for the culling panel
+struct CullingStats
+{
+    CullingStrategy Strategy = CullingStrategy::Auto;
+    uint32_t TraversedSubtrees = 0;
+    uint32_t ScannedSubtrees = 0;
+    uint32_t NodesVisited = 0;
+    uint32_t ObjectsTested = 0; // objects the SoA kernels ran on
+    uint32_t VisibleCount = 0;
+    float VisibleFraction = 0.0f; // of the objects in subtrees crossing the frustum
+    float TraversalMs = 0.0f;
+    float ScanMs = 0.0f; // SoA kernels only, what the cost model calibrates on
+    float EmitMs = 0.0f; // building or gathering the instance records of the visible objects
+    float NodeCostNs = 0.0f;
+    float ObjectCostNs = 0.0f;
+};
+
+// Chooses between walking a BVH subtree and scanning all of its objects. Per node and per object costs
+// are calibrated from the timings of previous ticks, the visible fraction is tracked the same way.
+class CullingCostModel
+{
+public:
+    // true when a straight scan of the subtree is expected to beat traversing it
+    [[nodiscard]] bool PreferScan(uint32_t nodeCount, uint32_t objectCount) const;
+
+    // objectsCrossing counts the objects of subtrees intersecting the frustum, visibleCrossing the visible ones among them
+    void Update(uint32_t nodesVisited, float traversalMs, uint32_t objectsTested, float scanMs,
+        uint32_t objectsCrossing, uint32_t visibleCrossing);
+
+    [[nodiscard]] float GetNodeCostNs() const { return m_NodeCostNs; }
+    [[nodiscard]] float GetObjectCostNs() const { return m_ObjectCostNs; }
+    [[nodiscard]] float GetVisibleFraction() const { return m_VisibleFraction; }
+
+private:
+    static constexpr float Smoothing = 0.1f; // weight of the newest tick
+
+    float m_NodeCostNs = 20.0f;
+    float m_ObjectCostNs = 1.0f;
+    float m_VisibleFraction = 0.5f;
+};
@@ -1,6 +1,5 @@
 #include "DebugRenderer.h"
 
-#include <queue>
 #include <directxtk/GeometricPrimitive.h>
 
 #include "Constants.h"
@@ -25,8 +24,8 @@ namespace
 }
 
 DebugRenderer::DebugRenderer(ID3D11Device* device, std::shared_ptr<Constants> constants,
-    const std::vector<BvhLinearNode>& tree) :
-    Renderer(device), m_Constants(std::move(constants)), m_BsTree(tree)
+    const std::vector<BvhLinearNode>& leaves) :
+    Renderer(device), m_Constants(std::move(constants)), m_Leaves(leaves)
 {
 }
 
@@ -40,35 +39,13 @@ void DebugRenderer::Render(ID3D11DeviceContext* context)
     const auto view = m_Constants->View.Transpose();
     const auto proj = m_Constants->Proj.Transpose();
 
-    int visibleDepth = std::log2(m_BsTree.size()) - 1;
-    visibleDepth = visibleDepth < 0 ? 0 : visibleDepth;
-    //visibleDepth = 0;
-    std::queue<uint32_t> q;
-    if (!m_BsTree.empty()) q.push(0);
-    int depth = 0;
-    while (!q.empty())
+    // leaves of the resident cells' trees, neighbours get different colors
+    for (size_t i = 0; i < m_Leaves.size(); ++i)
     {
-        const int size = q.size();
-        const auto color = s_LevelColor[(depth - visibleDepth) % _countof(s_LevelColor)];
-        for (int i = 0; i < size; ++i)
-        {
-            const auto nodeIdx = q.front();
-            auto& node = m_BsTree[nodeIdx];
-            q.pop();
-
-
-            if (node.ObjectCount == 0)
-            {
-                q.push(nodeIdx + 1);
-                q.push(node.SecondChildOffset);
-            }
-            else
-            {
-                auto world = Matrix::CreateScale(node.Bound.Radius) * Matrix::CreateTranslation(node.Bound.Center);
-                m_SphereGeo->Draw(world, view, proj, color, nullptr, true);
-            }
-        }
-        ++depth;
+        const auto& node = m_Leaves[i];
+        const auto color = s_LevelColor[i % _countof(s_LevelColor)];
+        auto world = Matrix::CreateScale(node.Bound.Radius) * Matrix::CreateTranslation(node.Bound.Center);
+        m_SphereGeo->Draw(world, view, proj, color, nullptr, true);
     }
 }
 
@@ -18,7 +18,7 @@ class DebugRenderer : public Renderer
 {
 public:
     DebugRenderer(ID3D11Device* device, std::shared_ptr<Constants> constants,
-        const std::vector<BvhLinearNode>& tree);
+        const std::vector<BvhLinearNode>& leaves);
 
     ~DebugRenderer() override = default;
 
@@ -35,6 +35,6 @@ private:
 
     std::unique_ptr<DirectX::GeometricPrimitive> m_SphereGeo = nullptr;
     std::shared_ptr<Constants> m_Constants;
-    const std::vector<BvhLinearNode>& m_BsTree;
+    const std::vector<BvhLinearNode>& m_Leaves;
 };
 
@@ -8,3 +8,22 @@ void GlobalContext::Initialize(size_t threadCount)
     Pool = std::make_unique<ThreadPool>(threadCount);
     ThreadCount = threadCount;
 }
+
+void GlobalContext::ParallelFor(size_t taskCount, const std::function<void(size_t)>& task) const
+{
+    if (taskCount == 0) return;
+    if (Pool == nullptr || taskCount == 1)
+    {
+        for (size_t i = 0; i < taskCount; ++i) task(i);
+        return;
+    }
+
+    std::vector<std::future<void>> futures;
+    futures.reserve(taskCount - 1);
+    for (size_t i = 0; i + 1 < taskCount; ++i)
+        futures.emplace_back(Pool->enqueue(task, i));
+
+    task(taskCount - 1);
+    for (auto& future : futures)
+        future.get();
+}
@@ -1,4 +1,5 @@
 #pragma once
+#include <functional>
 #include <memory>
 
 class ThreadPool;
@@ -8,6 +9,10 @@ struct GlobalContext
     size_t ThreadCount = 0;
 
     void Initialize(size_t threadCount);
+
+    // Runs task(0..taskCount-1) on the pool, the last one on the calling thread, and waits for all.
+    // Must not be called from a pool thread.
+    void ParallelFor(size_t taskCount, const std::function<void(size_t)>& task) const;
 };
 
 extern GlobalContext g_Context;
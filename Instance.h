@@ -1,15 +1,40 @@
 #pragma once
 #include <directxtk/SimpleMath.h>
+#include "InstancePacking.h"
 
+// GPU instance record, 32 bytes. SimpleVS.hlsl rebuilds the world matrix from it,
+// see InstancePacking.h for the rotation and id encoding.
 struct Instance
 {
-    DirectX::SimpleMath::Matrix World;
-    uint32_t GeoIdx{};
-    uint32_t MatIdx{};
+    DirectX::SimpleMath::Vector3 Position;
+    float Scale{};
+    uint32_t Rotation{};
+    uint32_t Ids{};
     uint32_t Color{};
     uint32_t Param{};
 
     Instance() = default;
-    Instance(DirectX::SimpleMath::Matrix world, uint32_t geoIdx, uint32_t matIdx, uint32_t color, uint32_t param)
-        : World(world), GeoIdx(geoIdx), MatIdx(matIdx), Color(color), Param(param) {}
+    Instance(DirectX::SimpleMath::Vector3 position, DirectX::SimpleMath::Quaternion rotation, float scale,
+        uint32_t geoIdx, uint32_t matIdx, uint32_t color, uint32_t param)
+        : Position(position), Scale(scale),
+        Rotation(InstancePacking::PackQuaternion(rotation.x, rotation.y, rotation.z, rotation.w)),
+        Ids(InstancePacking::PackIds(geoIdx, matIdx)), Color(color), Param(param) {}
+
+    [[nodiscard]] uint32_t GetGeoIdx() const { return InstancePacking::UnpackGeometry(Ids); }
+    [[nodiscard]] uint32_t GetMatIdx() const { return InstancePacking::UnpackMaterial(Ids); }
+
+    [[nodiscard]] DirectX::SimpleMath::Quaternion GetRotation() const
+    {
+        float q[4];
+        InstancePacking::UnpackQuaternion(Rotation, q);
+        return { q[0], q[1], q[2], q[3] };
+    }
+
+    // what the vertex shader reconstructs
+    [[nodiscard]] DirectX::SimpleMath::Matrix GetWorld() const
+    {
+        using namespace DirectX::SimpleMath;
+        return Matrix::CreateScale(Scale) * Matrix::CreateFromQuaternion(GetRotation()) * Matrix::CreateTranslation(Position);
+    }
 };
+static_assert(sizeof(Instance) == 32, "keep in sync with SimpleVS.hlsl");
@@ -0,0 +1,67 @@
+#pragma once
+// Encoding of the compact GPU instance record, free of DirectXMath so the kernels and tests can use it.
+// SimpleVS.hlsl decodes the same layout.
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace InstancePacking
+{
+    // smallest three quaternion: 2 bit index of the dropped largest component, then the other three
+    // in order at 10 bits each, mapped from [-1/sqrt2, 1/sqrt2] to [0, 1023]
+    constexpr uint32_t QuaternionBits = 10;
+    constexpr uint32_t QuaternionMax = (1u << QuaternionBits) - 1;
+    constexpr float HalfSqrt2 = 0.70710678f;
+    constexpr float QuaternionScale = QuaternionMax * 0.5f / HalfSqrt2;
+    constexpr float QuaternionBias = QuaternionMax * 0.5f;
+
+    constexpr uint32_t IdBits = 16;
+    constexpr uint32_t IdMax = (1u << IdBits) - 1;
+
+    inline uint32_t QuantizeComponent(float v)
+    {
+        const float q = std::clamp(v * QuaternionScale + QuaternionBias + 0.5f, 0.0f, static_cast<float>(QuaternionMax));
+        return static_cast<uint32_t>(q);
+    }
+
+    // q must be normalized, q and -q encode the same rotation
+    inline uint32_t PackQuaternion(float x, float y, float z, float w)
+    {
+        const float q[4] = { x, y, z, w };
+        uint32_t largest = 0;
+        for (uint32_t k = 1; k < 4; ++k)
+            if (std::abs(q[k]) > std::abs(q[largest])) largest = k;
+
+        // flip so the dropped component is positive and can be rebuilt from the other three
+        const float sign = q[largest] < 0.0f ? -1.0f : 1.0f;
+        uint32_t packed = largest;
+        for (uint32_t k = 0; k < 4; ++k)
+            if (k != largest) packed = packed << QuaternionBits | QuantizeComponent(q[k] * sign);
+        return packed;
+    }
+
+    inline void UnpackQuaternion(uint32_t packed, float q[4])
+    {
+        const uint32_t largest = packed >> QuaternionBits * 3;
+        float sumSq = 0.0f;
+        uint32_t shift = QuaternionBits * 3;
+        for (uint32_t k = 0; k < 4; ++k)
+        {
+            if (k == largest) continue;
+            shift -= QuaternionBits;
+            const float v = ((packed >> shift) & QuaternionMax) / QuaternionScale - HalfSqrt2;
+            q[k] = v;
+            sumSq += v * v;
+        }
+        q[largest] = std::sqrt(std::max(0.0f, 1.0f - sumSq));
+    }
+
+    // geometry in the low half, material in the high half
+    inline uint32_t PackIds(uint32_t geometryIndex, uint32_t materialIndex)
+    {
+        return std::min(geometryIndex, IdMax) | std::min(materialIndex, IdMax) << IdBits;
+    }
+
+    inline uint32_t UnpackGeometry(uint32_t ids) { return ids & IdMax; }
+    inline uint32_t UnpackMaterial(uint32_t ids) { return ids >> IdBits; }
+}
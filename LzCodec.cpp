@@ -0,0 +1,133 @@
+#include "LzCodec.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    constexpr size_t MinMatch = 4;
+    constexpr size_t LastLiterals = 5; // the block ends with at least this many literals
+    constexpr size_t MatchStartLimit = 12; // no match starts closer than this to the end
+    constexpr size_t MaxOffset = 65535;
+    constexpr uint32_t HashLog = 12;
+    constexpr uint32_t SkipTrigger = 6; // misses before the search step grows, skips incompressible data fast
+
+    uint32_t Read32(const uint8_t* p)
+    {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    uint32_t Hash(uint32_t sequence)
+    {
+        return sequence * 2654435761u >> (32 - HashLog);
+    }
+
+    uint8_t* WriteLength(uint8_t* op, size_t length)
+    {
+        for (; length >= 255; length -= 255) *op++ = 255;
+        *op++ = static_cast<uint8_t>(length);
+        return op;
+    }
+
+    uint8_t* WriteSequence(uint8_t* op, const uint8_t* literals, size_t literalCount, size_t offset, size_t matchLength)
+    {
+        uint8_t* token = op++;
+        *token = static_cast<uint8_t>(std::min<size_t>(literalCount, 15) << 4);
+        if (literalCount >= 15) op = WriteLength(op, literalCount - 15);
+        if (literalCount > 0) std::memcpy(op, literals, literalCount);
+        op += literalCount;
+        if (matchLength == 0) return op;
+
+        *op++ = static_cast<uint8_t>(offset);
+        *op++ = static_cast<uint8_t>(offset >> 8);
+        const size_t length = matchLength - MinMatch;
+        *token |= static_cast<uint8_t>(std::min<size_t>(length, 15));
+        if (length >= 15) op = WriteLength(op, length - 15);
+        return op;
+    }
+
+    // false when the length runs past the end
+    bool ReadLength(const uint8_t*& ip, const uint8_t* end, size_t& length)
+    {
+        uint8_t byte;
+        do
+        {
+            if (ip == end) return false;
+            byte = *ip++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }
+}
+
+size_t LzCodec::Compress(const uint8_t* src, size_t size, uint8_t* dst)
+{
+    uint8_t* op = dst;
+    size_t anchor = 0;
+    if (size > MatchStartLimit)
+    {
+        // positions + 1, 0 for none
+        std::vector<uint32_t> table(size_t{ 1 } << HashLog, 0);
+        const size_t matchEnd = size - LastLiterals;
+        size_t ip = 0;
+        uint32_t misses = 0;
+        while (ip + MatchStartLimit <= size)
+        {
+            const uint32_t sequence = Read32(src + ip);
+            uint32_t& entry = table[Hash(sequence)];
+            const size_t candidate = entry;
+            entry = static_cast<uint32_t>(ip + 1);
+            if (candidate == 0 || ip + 1 - candidate > MaxOffset || Read32(src + candidate - 1) != sequence)
+            {
+                ip += 1 + (misses++ >> SkipTrigger);
+                continue;
+            }
+
+            const size_t match = candidate - 1;
+            size_t length = MinMatch;
+            while (ip + length < matchEnd && src[match + length] == src[ip + length]) ++length;
+            op = WriteSequence(op, src + anchor, ip - anchor, ip - match, length);
+            ip += length;
+            anchor = ip;
+            misses = 0;
+        }
+    }
+    return WriteSequence(op, src + anchor, size - anchor, 0, 0) - dst;
+}
+
+bool LzCodec::Decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize)
+{
+    const uint8_t* ip = src;
+    const uint8_t* const end = src + srcSize;
+    size_t op = 0;
+    while (ip < end)
+    {
+        const uint8_t token = *ip++;
+        size_t literals = token >> 4;
+        if (literals == 15 && !ReadLength(ip, end, literals)) return false;
+        if (literals > static_cast<size_t>(end - ip) || literals > dstSize - op) return false;
+        if (literals > 0) std::memcpy(dst + op, ip, literals);
+        ip += literals;
+        op += literals;
+        if (ip == end) break; // the last sequence has no match
+
+        if (end - ip < 2) return false;
+        const size_t offset = ip[0] | ip[1] << 8;
+        ip += 2;
+        size_t length = token & 15;
+        if (length == 15 && !ReadLength(ip, end, length)) return false;
+        length += MinMatch;
+        if (offset == 0 || offset > op || length > dstSize - op) return false;
+
+        // overlapping matches repeat the last offset bytes, they are copied a byte at a time
+        uint8_t* out = dst + op;
+        const uint8_t* from = out - offset;
+        if (offset >= length) std::memcpy(out, from, length);
+        else for (size_t i = 0; i < length; ++i) out[i] = from[i];
+        op += length;
+    }
+    return op == dstSize;
+}
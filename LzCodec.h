@@ -0,0 +1,15 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// LZ77 block codec in the LZ4 block format: sequences of a token (literal and match length nibbles),
+// literals and a 16 bit match offset, the last sequence only literals. Favors decoding speed over ratio.
+namespace LzCodec
+{
+    [[nodiscard]] constexpr size_t GetMaxCompressedSize(size_t size) { return size + size / 255 + 16; }
+
+    // Returns the compressed size, dst must hold GetMaxCompressedSize(size) bytes
+    size_t Compress(const uint8_t* src, size_t size, uint8_t* dst);
+    // Decodes exactly dstSize bytes, false on malformed input. Never reads or writes out of bounds.
+    [[nodiscard]] bool Decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize);
+}
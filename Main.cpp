@@ -10,6 +10,7 @@
 #include "imgui_impl_win32.h"
 #include "GlobalContext.h"
 #include "WorldSystem.h"
+#include "CullingKernel.h"
 #include "PlaneRenderer.h"
 #include "ModelRenderer.h"
 #include "Camera.h"
@@ -114,7 +115,7 @@ int main(int, char**)
 
         UpdateConstants(io);
 
-        *g_Instances = g_WorldSystem->Tick(*g_Camera);
+        g_WorldSystem->Tick(*g_Camera, *g_Instances);
 
         ImGui::Begin("Culling tick");
         ImGui::Text("Object count : %d\tVisible count : %d\tFrame rate : %2.1f FPS", 
@@ -133,6 +134,56 @@ int main(int, char**)
         if (changed)
             g_WorldSystem->GenerateBvh(objectInNode, static_cast<BvhTree::SpitMethod>(splitMethod));
 
+        static int cullingIsa = 0;
+        const char* isaNames[] = { "Auto", "Scalar", "SSE2", "SSE4.1", "AVX2", "AVX-512", "NEON" };
+        ImGui::Text("Culling ISA : %s\tDetected : %s",
+            CullingDispatcher::GetName(CullingDispatcher::GetActiveIsa()),
+            CullingDispatcher::GetName(CullingDispatcher::GetDetectedIsa()));
+        if (ImGui::Combo("Force ISA", &cullingIsa, isaNames, _countof(isaNames)) &&
+            !CullingDispatcher::ForceIsa(static_cast<CullingIsa>(cullingIsa - 1)))
+            cullingIsa = static_cast<int>(CullingDispatcher::GetActiveIsa()) + 1;
+        bool quantized = g_WorldSystem->IsQuantizedCulling();
+        if (ImGui::Checkbox("16 bit culling bounds", &quantized))
+            g_WorldSystem->SetQuantizedCulling(quantized);
+        static int strategy = 0;
+        const char* strategyNames[] = { "Auto", "BVH", "Brute force" };
+        if (ImGui::Combo("Culling strategy", &strategy, strategyNames, _countof(strategyNames)))
+            g_WorldSystem->SetCullingStrategy(static_cast<CullingStrategy>(strategy - 1));
+        const auto& stats = g_WorldSystem->GetCullingStats();
+        ImGui::Text("Subtrees traversed : %d\tscanned : %d\tNodes : %d\tObjects tested : %d",
+            stats.TraversedSubtrees, stats.ScannedSubtrees, stats.NodesVisited, stats.ObjectsTested);
+        ImGui::Text("Traversal : %.3f ms\tScan : %.3f ms\tEmit : %.3f ms\tNode : %.1f ns\tObject : %.2f ns\tVisible fraction : %.2f",
+            stats.TraversalMs, stats.ScanMs, stats.EmitMs, stats.NodeCostNs, stats.ObjectCostNs, stats.VisibleFraction);
+        bool compact = g_WorldSystem->IsCompactObjects();
+        if (ImGui::Checkbox("Compact objects", &compact))
+            g_WorldSystem->SetCompactObjects(compact);
+        ImGui::SameLine();
+        ImGui::Text("%.2f MB", g_WorldSystem->GetObjectMemoryUsage() / (1024.0f * 1024.0f));
+        const auto& streaming = g_WorldSystem->GetStreamingStats();
+        ImGui::Text("Resident cells : %u\tReading : %u\tLoading : %u\tSlots : %u\tResident objects : %u",
+            streaming.ResidentCells, streaming.ReadingCells, streaming.LoadingCells, streaming.Slots, streaming.ResidentObjects);
+        ImGui::Text("Cancelled loads : %u\tPrefetch reads : %u\tDemoted prefetches : %u\tFailed cells : %u\tTop level build : %.1f us",
+            streaming.CancelledLoads, streaming.PrefetchReads, streaming.DemotedPrefetches, streaming.FailedCells,
+            streaming.TopLevelBuildUs);
+        float streamingRadii[2] = { g_WorldSystem->GetStreamingInnerRadius(), g_WorldSystem->GetStreamingOuterRadius() };
+        if (ImGui::DragFloat2("Stream in / out radius", streamingRadii, 10.0f, 0.0f, 20000.0f))
+            g_WorldSystem->SetStreamingRadii(streamingRadii[0], streamingRadii[1]);
+        float prefetchHorizon = g_WorldSystem->GetPrefetchHorizon();
+        if (ImGui::SliderFloat("Prefetch horizon (s)", &prefetchHorizon, 0.0f, 8.0f))
+            g_WorldSystem->SetPrefetchHorizon(prefetchHorizon);
+        const auto& residency = g_WorldSystem->GetResidencyStats();
+        ImGui::Text("Streaming memory : %.1f / %.1f MB\tCell limit : %u\tEvictions : %u",
+            residency.Used / (1024.0f * 1024.0f), residency.Budget / (1024.0f * 1024.0f), residency.CellLimit, residency.Evictions);
+        int budgetMb = static_cast<int>(g_WorldSystem->GetStreamingBudget() >> 20);
+        if (ImGui::SliderInt("Streaming budget (MB)", &budgetMb, 4, 1024))
+            g_WorldSystem->SetStreamingBudget(static_cast<size_t>(budgetMb) << 20);
+        bool precomputed = g_WorldSystem->IsPrecomputedInstances();
+        if (ImGui::Checkbox("Precomputed instances", &precomputed))
+            g_WorldSystem->SetPrecomputedInstances(precomputed);
+        float minScreenRadius = g_WorldSystem->GetMinScreenRadius();
+        if (ImGui::SliderFloat("Min screen radius (px)", &minScreenRadius, 0.0f, 8.0f))
+            g_WorldSystem->SetMinScreenRadius(minScreenRadius);
+
         ImGui::End();
 
         // Rendering
@@ -235,18 +286,20 @@ void InitWorldStreaming()
 {
     g_Context.Initialize(4);
 
-    g_WorldSystem = std::make_unique<WorldSystem>();
-    g_WorldSystem->Initialize();
     g_Instances = std::make_shared<std::vector<Instance>>();
 
     g_PassConstants = std::make_shared<Constants>();
     g_PlaneRender = std::make_unique<PlaneRenderer>(g_pd3dDevice, g_PassConstants);
     g_PlaneRender->Initialize(g_pd3dDeviceContext);
 
-    g_ModelRender = std::make_unique<ModelRenderer>(g_pd3dDevice, L"./Asset/patrick/patrick.obj", g_PassConstants, g_Instances);
-    g_ModelRender->Initialize(g_pd3dDeviceContext);
+    // culling bounds come from the meshes, load them first
+    auto modelRender = std::make_unique<ModelRenderer>(g_pd3dDevice, L"./Asset/patrick/patrick.obj", g_PassConstants, g_Instances);
+    modelRender->Initialize(g_pd3dDeviceContext);
+    g_WorldSystem = std::make_unique<WorldSystem>();
+    g_WorldSystem->Initialize(modelRender->GetGeometryExtents());
+    g_ModelRender = std::move(modelRender);
 
-    g_DebugRender = std::make_unique<DebugRenderer>(g_pd3dDevice, g_PassConstants, g_WorldSystem->GetBvhTree());
+    g_DebugRender = std::make_unique<DebugRenderer>(g_pd3dDevice, g_PassConstants, g_WorldSystem->GetBvhLeaves());
     g_DebugRender->Initialize(g_pd3dDeviceContext);
 
     g_Camera = std::make_unique<Camera>();
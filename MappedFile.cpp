@@ -0,0 +1,72 @@
+#include "MappedFile.h"
+
+#include <stdexcept>
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::filesystem::path& path)
+{
+    m_File = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (m_File == INVALID_HANDLE_VALUE)
+    {
+        m_File = nullptr;
+        throw std::runtime_error("can't open " + path.string());
+    }
+
+    LARGE_INTEGER size{};
+    GetFileSizeEx(m_File, &size);
+    m_Size = static_cast<size_t>(size.QuadPart);
+    if (m_Size == 0) return;
+
+    m_Mapping = CreateFileMappingW(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_Mapping != nullptr) m_Data = static_cast<const uint8_t*>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+    if (m_Data == nullptr)
+    {
+        if (m_Mapping != nullptr) CloseHandle(m_Mapping);
+        CloseHandle(m_File);
+        throw std::runtime_error("can't map " + path.string());
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_Data != nullptr) UnmapViewOfFile(m_Data);
+    if (m_Mapping != nullptr) CloseHandle(m_Mapping);
+    if (m_File != nullptr) CloseHandle(m_File);
+}
+#else
+MappedFile::MappedFile(const std::filesystem::path& path)
+{
+    m_File = open(path.c_str(), O_RDONLY);
+    if (m_File < 0) throw std::runtime_error("can't open " + path.string());
+
+    struct stat status{};
+    fstat(m_File, &status);
+    m_Size = static_cast<size_t>(status.st_size);
+    if (m_Size == 0) return;
+
+    void* data = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, m_File, 0);
+    if (data == MAP_FAILED)
+    {
+        close(m_File);
+        m_File = -1;
+        throw std::runtime_error("can't map " + path.string());
+    }
+    m_Data = static_cast<const uint8_t*>(data);
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_Data != nullptr) munmap(const_cast<uint8_t*>(m_Data), m_Size);
+    if (m_File >= 0) close(m_File);
+}
+#endif
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+// Read only view of a whole file mapped into memory, pages are read in by the OS on first touch
+class MappedFile
+{
+public:
+    // throws std::runtime_error if the file can't be opened or mapped
+    explicit MappedFile(const std::filesystem::path& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    [[nodiscard]] const uint8_t* GetData() const { return m_Data; }
+    [[nodiscard]] size_t GetSize() const { return m_Size; }
+
+private:
+    const uint8_t* m_Data = nullptr;
+    size_t m_Size = 0;
+#ifdef _WIN32
+    void* m_File = nullptr;
+    void* m_Mapping = nullptr;
+#else
+    int m_File = -1;
+#endif
+};
@@ -3,6 +3,7 @@
 #include "AssetImporter.h"
 #include "VertexPositionNormalTangentTexture.h"
 #include <d3dcompiler.h>
+#include <cmath>
 #include "Instance.h"
 
 #include <directxtk/GeometricPrimitive.h>
@@ -23,8 +24,9 @@ void ModelRenderer::Initialize(ID3D11DeviceContext* context)
 {
     m_Vc0 = std::make_unique<ConstantBuffer<Constants>>(m_Device);
 
-    auto [mesh, maxLen, bondingRadius] = 
+    auto [mesh, maxLen, bondingRadius, extents] = 
 		BuildVertices(L"./Asset/Mesh");
+	m_GeometryExtents = std::move(extents);
 	
     m_Vt0 = std::make_unique<StructuredBuffer<Vertex>>(m_Device, mesh.data(), mesh.size());
 	m_Constants->VertexPerMesh = maxLen;
@@ -81,6 +83,12 @@ void ModelRenderer::Render(ID3D11DeviceContext* context)
 void ModelRenderer::UpdateBuffer(ID3D11DeviceContext* context)
 {
 	m_Vc0->SetData(context, *m_Constants);
+	if (m_Instances->size() > m_Vt1->m_Capacity)
+	{
+		UINT capacity = m_Vt1->m_Capacity;
+		while (capacity < m_Instances->size()) capacity *= 2;
+		m_Vt1 = std::make_unique<StructuredBuffer<Instance>>(m_Device, capacity);
+	}
 	m_Vt1->SetData(context, m_Instances->data(), m_Instances->size());
 }
 
@@ -89,13 +97,19 @@ ModelRenderer::MeshData ModelRenderer::BuildVertices(
 {
 	std::vector<std::vector<VertexPositionNormalTangentTexture>> vbs;
 	std::vector<float> rads;
+	std::vector<SimpleMath::Vector3> extents;
 	for (const auto& entry : std::filesystem::directory_iterator(folder))
 	{
 		if (entry.is_regular_file())
 		{
 			auto [mesh, tex, radius] = AssetImporter::LoadTriangleList(entry.path());
+			// vertices are already relative to the unit bounding sphere, the box is centred on it too
+			SimpleMath::Vector3 extent;
+			for (const auto& vertex : mesh)
+				extent = SimpleMath::Vector3::Max(extent, SimpleMath::Vector3(std::abs(vertex.Pos.x), std::abs(vertex.Pos.y), std::abs(vertex.Pos.z)));
 			vbs.push_back(mesh);
 			rads.push_back(radius);
+			extents.push_back(extent);
 		}
 	}
 
@@ -118,5 +132,5 @@ ModelRenderer::MeshData ModelRenderer::BuildVertices(
 		std::copy(vb.begin(), vb.end(), std::back_inserter(result));
 	}
 
-	return { result, maxLen, rads };
+	return { result, maxLen, rads, extents };
 }
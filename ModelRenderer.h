@@ -20,9 +20,14 @@ public:
     void Initialize(ID3D11DeviceContext* context) override;
     void Render(ID3D11DeviceContext* context) override;
 
+    // Half extents of each geometry inside its unit bounding sphere, indexed like StaticObject geometry ids.
+    // Filled by Initialize.
+    [[nodiscard]] const std::vector<DirectX::SimpleMath::Vector3>& GetGeometryExtents() const { return m_GeometryExtents; }
+
 private:
     void UpdateBuffer(ID3D11DeviceContext* context) override;
-    using MeshData = std::tuple<std::vector<VertexPositionNormalTangentTexture>, size_t, std::vector<float>>;
+    using MeshData = std::tuple<std::vector<VertexPositionNormalTangentTexture>, size_t, std::vector<float>,
+        std::vector<DirectX::SimpleMath::Vector3>>;
     static MeshData BuildVertices(std::filesystem::path folder);
 
     std::unique_ptr<DirectX::ConstantBuffer<Constants>> m_Vc0 = nullptr;
@@ -38,5 +43,6 @@ private:
     std::shared_ptr<Constants> m_Constants = nullptr;
     std::shared_ptr<std::vector<Instance>> m_Instances = nullptr;
     std::filesystem::path m_Asset{};
+    std::vector<DirectX::SimpleMath::Vector3> m_GeometryExtents{};
 };
 
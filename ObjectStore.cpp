@@ -0,0 +1,568 @@
+#include "ObjectStore.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <utility>
+#include "InstancePacking.h"
+
+using namespace DirectX;
+using namespace SimpleMath;
+
+namespace
+{
+    constexpr float QuantizedMax = 65535.0f;
+    constexpr uint32_t GatherBatch = 256;
+    constexpr float WidenMargin = 0.5f; // of the block's extent, added on each side when an object falls outside
+
+    uint16_t Quantize(float v, float origin, float step)
+    {
+        if (step <= 0.0f) return 0;
+        return static_cast<uint16_t>(std::clamp((v - origin) / step + 0.5f, 0.0f, QuantizedMax));
+    }
+
+    // reserving first keeps growth from allocating headroom, only the old and the new column are ever live
+    template <class T>
+    void ResizeExact(T& column, uint32_t size, typename T::value_type value = {})
+    {
+        if (size > column.capacity()) column.reserve(size);
+        column.resize(size, value);
+    }
+
+    template <class T>
+    void Release(T& column)
+    {
+        T().swap(column);
+    }
+
+    template <class T>
+    size_t GetBytes(const T& column)
+    {
+        return column.capacity() * sizeof(typename T::value_type);
+    }
+}
+
+void ObjectStore::Resize(uint32_t size)
+{
+    m_Size = size;
+    if (m_Compact)
+    {
+        ResizeExact(m_QuantizedX, size);
+        ResizeExact(m_QuantizedY, size);
+        ResizeExact(m_QuantizedZ, size);
+        ResizeExact(m_QuantizedScale, size);
+        ResizeExact(m_PackedRotation, size, InstancePacking::PackQuaternion(0.0f, 0.0f, 0.0f, 1.0f));
+        ResizeExact(m_PackedIds, size);
+        m_Blocks.resize((size + BlockCapacity - 1) / BlockCapacity);
+    }
+    else
+    {
+        ResizeExact(m_PositionX, size);
+        ResizeExact(m_PositionY, size);
+        ResizeExact(m_PositionZ, size);
+        ResizeExact(m_Scale, size);
+        ResizeExact(m_RotationX, size);
+        ResizeExact(m_RotationY, size);
+        ResizeExact(m_RotationZ, size);
+        ResizeExact(m_RotationW, size, 1.0f);
+        ResizeExact(m_GeometryIndex, size);
+        ResizeExact(m_MaterialIndex, size);
+    }
+    ResizeExact(m_Color, size);
+    if (!m_Param.empty()) ResizeExact(m_Param, size);
+    if (!m_MaxDrawDistance.empty()) ResizeExact(m_MaxDrawDistance, size);
+}
+
+void ObjectStore::ShrinkToFit()
+{
+    const auto shrink = [](auto&... columns) { (columns.shrink_to_fit(), ...); };
+    shrink(m_PositionX, m_PositionY, m_PositionZ, m_Scale, m_RotationX, m_RotationY, m_RotationZ, m_RotationW,
+        m_GeometryIndex, m_MaterialIndex, m_Color, m_Param, m_MaxDrawDistance,
+        m_QuantizedX, m_QuantizedY, m_QuantizedZ, m_QuantizedScale, m_PackedRotation, m_PackedIds, m_Blocks);
+}
+
+StaticObject ObjectStore::Get(uint32_t index) const
+{
+    StaticObject object(GetPosition(index), GetRotation(index), GetScale(index),
+        GetGeometryIndex(index), GetMaterialIndex(index), m_Color[index]);
+    object.Param = GetParam(index);
+    object.MaxDrawDistance = GetMaxDrawDistance(index);
+    return object;
+}
+
+void ObjectStore::Set(uint32_t index, const StaticObject& object)
+{
+    if (m_Compact)
+    {
+        const uint32_t block = index / BlockCapacity;
+        if (FitsBlock(block, object))
+        {
+            const Block& frame = m_Blocks[block];
+            m_QuantizedX[index] = Quantize(object.Position.x, frame.Origin[0], frame.Step[0]);
+            m_QuantizedY[index] = Quantize(object.Position.y, frame.Origin[1], frame.Step[1]);
+            m_QuantizedZ[index] = Quantize(object.Position.z, frame.Origin[2], frame.Step[2]);
+            m_QuantizedScale[index] = Quantize(object.Scale, 0.0f, frame.ScaleStep);
+        }
+        else
+        {
+            // widen the frame with room to spare, the other objects are requantized from their decoded values,
+            // so the error carried over stays a geometric series of shrinking steps
+            const uint32_t first = block * BlockCapacity;
+            const uint32_t count = std::min(BlockCapacity, m_Size - first);
+            std::vector<float> decoded(4 * static_cast<size_t>(count));
+            float* x = decoded.data();
+            float* y = x + count;
+            float* z = y + count;
+            float* scale = z + count;
+            CullingDispatcher::GetKernels().DecodeSpheres(GetQuantizedColumns(first, false), count, x, y, z, scale);
+            x[index - first] = object.Position.x;
+            y[index - first] = object.Position.y;
+            z[index - first] = object.Position.z;
+            scale[index - first] = object.Scale;
+            EncodeBlock(block, count, x, y, z, scale, m_Blocks[block].Padding, WidenMargin);
+        }
+        m_PackedRotation[index] = InstancePacking::PackQuaternion(object.Rotation.x, object.Rotation.y, object.Rotation.z, object.Rotation.w);
+        m_PackedIds[index] = InstancePacking::PackIds(object.GeometryIndex, object.MaterialIndex);
+    }
+    else
+    {
+        m_PositionX[index] = object.Position.x;
+        m_PositionY[index] = object.Position.y;
+        m_PositionZ[index] = object.Position.z;
+        m_Scale[index] = object.Scale;
+        m_RotationX[index] = object.Rotation.x;
+        m_RotationY[index] = object.Rotation.y;
+        m_RotationZ[index] = object.Rotation.z;
+        m_RotationW[index] = object.Rotation.w;
+        m_GeometryIndex[index] = object.GeometryIndex;
+        m_MaterialIndex[index] = object.MaterialIndex;
+    }
+    m_Color[index] = object.Color;
+
+    if (object.Param != 0 && m_Param.empty()) m_Param.resize(m_Size);
+    if (!m_Param.empty()) m_Param[index] = object.Param;
+    if (object.MaxDrawDistance != 0.0f && m_MaxDrawDistance.empty()) m_MaxDrawDistance.resize(m_Size);
+    if (!m_MaxDrawDistance.empty()) m_MaxDrawDistance[index] = object.MaxDrawDistance;
+}
+
+void ObjectStore::Assign(uint32_t begin, const ObjectStore& source)
+{
+    const uint32_t count = source.GetSize();
+    assert(begin + count <= m_Size);
+
+    if (source.m_Compact || (m_Compact && begin % BlockCapacity != 0))
+    {
+        for (uint32_t i = 0; i < count; ++i) Set(begin + i, source.Get(i));
+        return;
+    }
+
+    if (m_Compact)
+    {
+        // whole blocks get a frame of their own, the tail of a partial last block is left as it was
+        for (uint32_t offset = 0; offset < count; offset += BlockCapacity)
+        {
+            EncodeBlock((begin + offset) / BlockCapacity, std::min(BlockCapacity, count - offset),
+                source.m_PositionX.data() + offset, source.m_PositionY.data() + offset, source.m_PositionZ.data() + offset,
+                source.m_Scale.data() + offset, 0.0f, 0.0f);
+        }
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            m_PackedRotation[begin + i] = source.GetPackedRotation(i);
+            m_PackedIds[begin + i] = InstancePacking::PackIds(source.m_GeometryIndex[i], source.m_MaterialIndex[i]);
+        }
+    }
+    else
+    {
+        const auto copy = [&](const auto& from, auto& to) { std::copy(from.begin(), from.begin() + count, to.begin() + begin); };
+        copy(source.m_PositionX, m_PositionX);
+        copy(source.m_PositionY, m_PositionY);
+        copy(source.m_PositionZ, m_PositionZ);
+        copy(source.m_Scale, m_Scale);
+        copy(source.m_RotationX, m_RotationX);
+        copy(source.m_RotationY, m_RotationY);
+        copy(source.m_RotationZ, m_RotationZ);
+        copy(source.m_RotationW, m_RotationW);
+        copy(source.m_GeometryIndex, m_GeometryIndex);
+        copy(source.m_MaterialIndex, m_MaterialIndex);
+    }
+    std::copy(source.m_Color.begin(), source.m_Color.begin() + count, m_Color.begin() + begin);
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const uint32_t param = source.GetParam(i);
+        if (param != 0 && m_Param.empty()) m_Param.resize(m_Size);
+        if (!m_Param.empty()) m_Param[begin + i] = param;
+        const float maxDrawDistance = source.GetMaxDrawDistance(i);
+        if (maxDrawDistance != 0.0f && m_MaxDrawDistance.empty()) m_MaxDrawDistance.resize(m_Size);
+        if (!m_MaxDrawDistance.empty()) m_MaxDrawDistance[begin + i] = maxDrawDistance;
+    }
+}
+
+void ObjectStore::PrepareAssign(const ObjectStore& source)
+{
+    if (!source.m_Param.empty() && m_Param.empty()) m_Param.resize(m_Size);
+    if (!source.m_MaxDrawDistance.empty() && m_MaxDrawDistance.empty()) m_MaxDrawDistance.resize(m_Size);
+}
+
+ObjectStore ObjectStore::Extract(uint32_t begin, uint32_t end) const
+{
+    ObjectStore result;
+    result.Resize(end - begin);
+    for (uint32_t i = begin; i < end; ++i) result.Set(i - begin, Get(i));
+    return result;
+}
+
+const void* ObjectStore::GetColumnData(ObjectColumn column) const
+{
+    assert(!m_Compact);
+
+    const auto data = [](const auto& values) -> const void* { return values.empty() ? nullptr : values.data(); };
+    switch (column)
+    {
+    case ObjectColumn::PositionX: return data(m_PositionX);
+    case ObjectColumn::PositionY: return data(m_PositionY);
+    case ObjectColumn::PositionZ: return data(m_PositionZ);
+    case ObjectColumn::Scale: return data(m_Scale);
+    case ObjectColumn::RotationX: return data(m_RotationX);
+    case ObjectColumn::RotationY: return data(m_RotationY);
+    case ObjectColumn::RotationZ: return data(m_RotationZ);
+    case ObjectColumn::RotationW: return data(m_RotationW);
+    case ObjectColumn::GeometryIndex: return data(m_GeometryIndex);
+    case ObjectColumn::MaterialIndex: return data(m_MaterialIndex);
+    case ObjectColumn::Color: return data(m_Color);
+    case ObjectColumn::Param: return data(m_Param);
+    case ObjectColumn::MaxDrawDistance: return data(m_MaxDrawDistance);
+    default: return nullptr;
+    }
+}
+
+void* ObjectStore::GetColumnData(ObjectColumn column)
+{
+    return const_cast<void*>(std::as_const(*this).GetColumnData(column));
+}
+
+void ObjectStore::AllocateColumns(uint32_t count, bool param, bool maxDrawDistance)
+{
+    assert(!m_Compact);
+
+    Release(m_Param);
+    Release(m_MaxDrawDistance);
+    Resize(count);
+    if (param) m_Param.resize(count);
+    if (maxDrawDistance) m_MaxDrawDistance.resize(count);
+}
+
+template <class T>
+void ObjectStore::Permute(Column<T>& column, const std::vector<uint32_t>& order)
+{
+    if (column.empty()) return;
+
+    Column<T> ordered(order.size());
+    for (size_t i = 0; i < order.size(); ++i) ordered[i] = column[order[i]];
+    column.swap(ordered);
+}
+
+void ObjectStore::Permute(const std::vector<uint32_t>& order)
+{
+    assert(order.size() == m_Size);
+
+    // blocks are regrouped, so compact objects are requantized from their decoded values and each new block
+    // carries the error of the old blocks its objects came from
+    std::vector<float> carried;
+    const bool compact = m_Compact;
+    if (compact)
+    {
+        carried.resize(m_Blocks.size());
+        for (uint32_t i = 0; i < m_Size; ++i)
+        {
+            float& error = carried[i / BlockCapacity];
+            error = std::max(error, m_Blocks[order[i] / BlockCapacity].Padding);
+        }
+        Decode();
+    }
+
+    // one column at a time, so only two columns are in flight
+    Permute(m_PositionX, order);
+    Permute(m_PositionY, order);
+    Permute(m_PositionZ, order);
+    Permute(m_Scale, order);
+    Permute(m_RotationX, order);
+    Permute(m_RotationY, order);
+    Permute(m_RotationZ, order);
+    Permute(m_RotationW, order);
+    Permute(m_GeometryIndex, order);
+    Permute(m_MaterialIndex, order);
+    Permute(m_Color, order);
+    Permute(m_Param, order);
+    Permute(m_MaxDrawDistance, order);
+
+    if (compact) Encode(carried);
+}
+
+void ObjectStore::SetCompact(bool compact)
+{
+    if (compact == m_Compact) return;
+
+    if (compact) Encode({});
+    else Decode();
+}
+
+size_t ObjectStore::GetMemoryUsage() const
+{
+    return GetBytes(m_PositionX) + GetBytes(m_PositionY) + GetBytes(m_PositionZ) + GetBytes(m_Scale) +
+        GetBytes(m_RotationX) + GetBytes(m_RotationY) + GetBytes(m_RotationZ) + GetBytes(m_RotationW) +
+        GetBytes(m_GeometryIndex) + GetBytes(m_MaterialIndex) + GetBytes(m_Color) +
+        GetBytes(m_Param) + GetBytes(m_MaxDrawDistance) +
+        GetBytes(m_QuantizedX) + GetBytes(m_QuantizedY) + GetBytes(m_QuantizedZ) + GetBytes(m_QuantizedScale) +
+        GetBytes(m_PackedRotation) + GetBytes(m_PackedIds) + GetBytes(m_Blocks);
+}
+
+Vector3 ObjectStore::GetPosition(uint32_t index) const
+{
+    if (!m_Compact) return { m_PositionX[index], m_PositionY[index], m_PositionZ[index] };
+
+    const Block& block = m_Blocks[index / BlockCapacity];
+    return {
+        block.Origin[0] + static_cast<float>(m_QuantizedX[index]) * block.Step[0],
+        block.Origin[1] + static_cast<float>(m_QuantizedY[index]) * block.Step[1],
+        block.Origin[2] + static_cast<float>(m_QuantizedZ[index]) * block.Step[2] };
+}
+
+float ObjectStore::GetScale(uint32_t index) const
+{
+    if (!m_Compact) return m_Scale[index];
+    return static_cast<float>(m_QuantizedScale[index]) * m_Blocks[index / BlockCapacity].ScaleStep;
+}
+
+BoundingSphere ObjectStore::GetBound(uint32_t index) const
+{
+    return { GetPosition(index), GetScale(index) + GetBoundPadding(index) };
+}
+
+float ObjectStore::GetBoundPadding(uint32_t index) const
+{
+    return m_Compact ? m_Blocks[index / BlockCapacity].Padding : 0.0f;
+}
+
+void ObjectStore::GetBounds(uint32_t begin, uint32_t end, float* x, float* y, float* z, float* radius) const
+{
+    if (!m_Compact)
+    {
+        std::copy(m_PositionX.begin() + begin, m_PositionX.begin() + end, x);
+        std::copy(m_PositionY.begin() + begin, m_PositionY.begin() + end, y);
+        std::copy(m_PositionZ.begin() + begin, m_PositionZ.begin() + end, z);
+        std::copy(m_Scale.begin() + begin, m_Scale.begin() + end, radius);
+        return;
+    }
+
+    const auto& kernels = CullingDispatcher::GetKernels();
+    for (uint32_t first = begin; first < end;)
+    {
+        const uint32_t last = std::min(end, (first / BlockCapacity + 1) * BlockCapacity);
+        const uint32_t offset = first - begin;
+        kernels.DecodeSpheres(GetQuantizedColumns(first, true), last - first, x + offset, y + offset, z + offset, radius + offset);
+        first = last;
+    }
+}
+
+void ObjectStore::GatherPlacements(const uint32_t* indices, uint32_t count, float* x, float* y, float* z, float* scale) const
+{
+    if (!m_Compact)
+    {
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            x[i] = m_PositionX[indices[i]];
+            y[i] = m_PositionY[indices[i]];
+            z[i] = m_PositionZ[indices[i]];
+            scale[i] = m_Scale[indices[i]];
+        }
+        return;
+    }
+
+    // gather runs within one block, then widen them a batch at a time
+    alignas(Alignment) uint16_t quantized[4][GatherBatch];
+    const auto& kernels = CullingDispatcher::GetKernels();
+    for (uint32_t first = 0; first < count;)
+    {
+        const uint32_t block = indices[first] / BlockCapacity;
+        uint32_t last = first;
+        for (; last < count && last - first < GatherBatch && indices[last] / BlockCapacity == block; ++last)
+        {
+            const uint32_t index = indices[last];
+            quantized[0][last - first] = m_QuantizedX[index];
+            quantized[1][last - first] = m_QuantizedY[index];
+            quantized[2][last - first] = m_QuantizedZ[index];
+            quantized[3][last - first] = m_QuantizedScale[index];
+        }
+
+        CullingColumns columns = GetQuantizedColumns(block * BlockCapacity, false);
+        columns.QuantizedX = quantized[0];
+        columns.QuantizedY = quantized[1];
+        columns.QuantizedZ = quantized[2];
+        columns.QuantizedRadius = quantized[3];
+        kernels.DecodeSpheres(columns, last - first, x + first, y + first, z + first, scale + first);
+        first = last;
+    }
+}
+
+Quaternion ObjectStore::GetRotation(uint32_t index) const
+{
+    if (!m_Compact) return { m_RotationX[index], m_RotationY[index], m_RotationZ[index], m_RotationW[index] };
+
+    float q[4];
+    InstancePacking::UnpackQuaternion(m_PackedRotation[index], q);
+    return { q[0], q[1], q[2], q[3] };
+}
+
+uint32_t ObjectStore::GetPackedRotation(uint32_t index) const
+{
+    if (m_Compact) return m_PackedRotation[index];
+    return InstancePacking::PackQuaternion(m_RotationX[index], m_RotationY[index], m_RotationZ[index], m_RotationW[index]);
+}
+
+uint32_t ObjectStore::GetGeometryIndex(uint32_t index) const
+{
+    return m_Compact ? InstancePacking::UnpackGeometry(m_PackedIds[index]) : m_GeometryIndex[index];
+}
+
+uint32_t ObjectStore::GetMaterialIndex(uint32_t index) const
+{
+    return m_Compact ? InstancePacking::UnpackMaterial(m_PackedIds[index]) : m_MaterialIndex[index];
+}
+
+void ObjectStore::Encode(const std::vector<float>& carried)
+{
+    m_QuantizedX.resize(m_Size);
+    m_QuantizedY.resize(m_Size);
+    m_QuantizedZ.resize(m_Size);
+    m_QuantizedScale.resize(m_Size);
+    m_PackedRotation.resize(m_Size);
+    m_PackedIds.resize(m_Size);
+    m_Blocks.assign((m_Size + BlockCapacity - 1) / BlockCapacity, Block{});
+
+    for (uint32_t block = 0; block < m_Blocks.size(); ++block)
+    {
+        const uint32_t first = block * BlockCapacity;
+        EncodeBlock(block, std::min(BlockCapacity, m_Size - first), m_PositionX.data() + first, m_PositionY.data() + first,
+            m_PositionZ.data() + first, m_Scale.data() + first, carried.empty() ? 0.0f : carried[block], 0.0f);
+    }
+    for (uint32_t i = 0; i < m_Size; ++i)
+    {
+        m_PackedRotation[i] = InstancePacking::PackQuaternion(m_RotationX[i], m_RotationY[i], m_RotationZ[i], m_RotationW[i]);
+        m_PackedIds[i] = InstancePacking::PackIds(m_GeometryIndex[i], m_MaterialIndex[i]);
+    }
+
+    Release(m_PositionX);
+    Release(m_PositionY);
+    Release(m_PositionZ);
+    Release(m_Scale);
+    Release(m_RotationX);
+    Release(m_RotationY);
+    Release(m_RotationZ);
+    Release(m_RotationW);
+    Release(m_GeometryIndex);
+    Release(m_MaterialIndex);
+    m_Compact = true;
+}
+
+void ObjectStore::Decode()
+{
+    m_PositionX.resize(m_Size);
+    m_PositionY.resize(m_Size);
+    m_PositionZ.resize(m_Size);
+    m_Scale.resize(m_Size);
+    m_RotationX.resize(m_Size);
+    m_RotationY.resize(m_Size);
+    m_RotationZ.resize(m_Size);
+    m_RotationW.resize(m_Size);
+    m_GeometryIndex.resize(m_Size);
+    m_MaterialIndex.resize(m_Size);
+
+    const auto& kernels = CullingDispatcher::GetKernels();
+    for (uint32_t first = 0; first < m_Size; first += BlockCapacity)
+    {
+        kernels.DecodeSpheres(GetQuantizedColumns(first, false), std::min(BlockCapacity, m_Size - first),
+            m_PositionX.data() + first, m_PositionY.data() + first, m_PositionZ.data() + first, m_Scale.data() + first);
+    }
+    for (uint32_t i = 0; i < m_Size; ++i)
+    {
+        float q[4];
+        InstancePacking::UnpackQuaternion(m_PackedRotation[i], q);
+        m_RotationX[i] = q[0];
+        m_RotationY[i] = q[1];
+        m_RotationZ[i] = q[2];
+        m_RotationW[i] = q[3];
+        m_GeometryIndex[i] = InstancePacking::UnpackGeometry(m_PackedIds[i]);
+        m_MaterialIndex[i] = InstancePacking::UnpackMaterial(m_PackedIds[i]);
+    }
+
+    Release(m_QuantizedX);
+    Release(m_QuantizedY);
+    Release(m_QuantizedZ);
+    Release(m_QuantizedScale);
+    Release(m_PackedRotation);
+    Release(m_PackedIds);
+    Release(m_Blocks);
+    m_Compact = false;
+}
+
+void ObjectStore::EncodeBlock(uint32_t block, uint32_t count, const float* x, const float* y, const float* z, const float* scale,
+    float carried, float margin)
+{
+    const uint32_t first = block * BlockCapacity;
+    const float* positions[3] = { x, y, z };
+    uint16_t* quantized[3] = { m_QuantizedX.data() + first, m_QuantizedY.data() + first, m_QuantizedZ.data() + first };
+
+    Block& frame = m_Blocks[block];
+    float diagonalSq = 0.0f;
+    float rounding = 0.0f;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        const auto [minimum, maximum] = std::minmax_element(positions[axis], positions[axis] + count);
+        const float lo = *minimum - (*maximum - *minimum) * margin;
+        const float hi = *maximum + (*maximum - *minimum) * margin;
+        frame.Origin[axis] = lo;
+        frame.Step[axis] = (hi - lo) / QuantizedMax;
+        diagonalSq += frame.Step[axis] * frame.Step[axis];
+        // float rounding of Origin + q * Step
+        rounding += std::max(std::abs(lo), std::abs(hi)) * 1e-6f;
+        for (uint32_t i = 0; i < count; ++i)
+            quantized[axis][i] = Quantize(positions[axis][i], frame.Origin[axis], frame.Step[axis]);
+    }
+    frame.ScaleStep = *std::max_element(scale, scale + count) * (1.0f + margin) / QuantizedMax;
+    for (uint32_t i = 0; i < count; ++i)
+        m_QuantizedScale[first + i] = Quantize(scale[i], 0.0f, frame.ScaleStep);
+
+    // half a step off per axis and for the scale, plus what earlier requantizations lost
+    frame.Padding = 0.5f * std::sqrt(diagonalSq) + 0.5f * frame.ScaleStep + rounding + carried;
+}
+
+bool ObjectStore::FitsBlock(uint32_t block, const StaticObject& object) const
+{
+    const Block& frame = m_Blocks[block];
+    const float position[3] = { object.Position.x, object.Position.y, object.Position.z };
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        const float offset = position[axis] - frame.Origin[axis];
+        if (offset < 0.0f || offset > frame.Step[axis] * QuantizedMax) return false;
+    }
+    return object.Scale >= 0.0f && object.Scale <= frame.ScaleStep * QuantizedMax;
+}
+
+CullingColumns ObjectStore::GetQuantizedColumns(uint32_t begin, bool bounds) const
+{
+    const Block& block = m_Blocks[begin / BlockCapacity];
+    CullingColumns columns;
+    columns.QuantizedX = m_QuantizedX.data() + begin;
+    columns.QuantizedY = m_QuantizedY.data() + begin;
+    columns.QuantizedZ = m_QuantizedZ.data() + begin;
+    columns.QuantizedRadius = m_QuantizedScale.data() + begin;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        columns.Origin[axis] = block.Origin[axis];
+        columns.Step[axis] = block.Step[axis];
+    }
+    columns.RadiusStep = block.ScaleStep;
+    columns.RadiusBias = bounds ? block.Padding : 0.0f;
+    return columns;
+}
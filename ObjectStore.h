@@ -0,0 +1,149 @@
+#pragma once
+#include <vector>
+#include <xsimd/xsimd.hpp>
+#include <directxtk/SimpleMath.h>
+#include "CullingKernel.h"
+#include "StaticObject.h"
+
+// Float mode columns in storage order, every value is 4 bytes
+enum class ObjectColumn : uint32_t
+{
+    PositionX,
+    PositionY,
+    PositionZ,
+    Scale,
+    RotationX,
+    RotationY,
+    RotationZ,
+    RotationW,
+    GeometryIndex,
+    MaterialIndex,
+    Color,
+    Param,
+    MaxDrawDistance,
+    Count,
+};
+
+// Objects in SoA form. Hot columns (position and scale, the bounding sphere) are walked by BVH builds,
+// refits and culling syncs; cold columns are only read per object, mostly for the visible ones
+// when instances are built. Callers that work with whole objects use the StaticObject view.
+class ObjectStore
+{
+public:
+    static constexpr uint32_t BlockCapacity = 1 << 11; // objects sharing a quantization frame
+
+    ObjectStore() = default;
+
+    // grows columns to exactly size, one at a time
+    void Resize(uint32_t size);
+    // releases memory left over from shrinking
+    void ShrinkToFit();
+    [[nodiscard]] uint32_t GetSize() const { return m_Size; }
+    [[nodiscard]] bool IsEmpty() const { return m_Size == 0; }
+
+    [[nodiscard]] StaticObject Get(uint32_t index) const;
+    void Set(uint32_t index, const StaticObject& object);
+
+    // Copies all of source to [begin, begin + source size), begin must be a multiple of BlockCapacity when compact
+    void Assign(uint32_t begin, const ObjectStore& source);
+    // Allocates the optional columns source uses, an Assign of a float mode source then only writes inside its
+    // range and may run on another thread alongside reads of other objects
+    void PrepareAssign(const ObjectStore& source);
+    [[nodiscard]] ObjectStore Extract(uint32_t begin, uint32_t end) const;
+
+    // Raw float mode columns, for world files. Param and MaxDrawDistance are null until allocated.
+    [[nodiscard]] const void* GetColumnData(ObjectColumn column) const;
+    [[nodiscard]] void* GetColumnData(ObjectColumn column);
+    // Resizes to count with Param and MaxDrawDistance allocated or released as asked, for columns
+    // filled in through GetColumnData. Float mode only.
+    void AllocateColumns(uint32_t count, bool param, bool maxDrawDistance);
+
+    // Reorders every column so that index i holds the object previously at order[i]
+    void Permute(const std::vector<uint32_t>& order);
+
+    // Compact storage, 20 bytes per object instead of 44: 16 bit position and scale relative to blocks
+    // of BlockCapacity consecutive objects (BVH ordered, so close together), a smallest three rotation
+    // and 16 bit geometry and material ids. Objects read back are the quantized ones, bounds are
+    // padded so they still contain the sphere of the object as it was set.
+    void SetCompact(bool compact);
+    [[nodiscard]] bool IsCompact() const { return m_Compact; }
+    [[nodiscard]] size_t GetMemoryUsage() const;
+
+    [[nodiscard]] DirectX::SimpleMath::Vector3 GetPosition(uint32_t index) const;
+    [[nodiscard]] float GetScale(uint32_t index) const;
+    [[nodiscard]] DirectX::BoundingSphere GetBound(uint32_t index) const;
+    // how far decoded positions and scales may be off, 0 unless compact
+    [[nodiscard]] float GetBoundPadding(uint32_t index) const;
+    // Bounds of [begin, end) into float columns, decoded a batch at a time when compact
+    void GetBounds(uint32_t begin, uint32_t end, float* x, float* y, float* z, float* radius) const;
+    // Positions and scales of the indexed objects, indices ascending
+    void GatherPlacements(const uint32_t* indices, uint32_t count, float* x, float* y, float* z, float* scale) const;
+
+    [[nodiscard]] DirectX::SimpleMath::Quaternion GetRotation(uint32_t index) const;
+    // InstancePacking smallest three code, stored as is when compact
+    [[nodiscard]] uint32_t GetPackedRotation(uint32_t index) const;
+    [[nodiscard]] uint32_t GetGeometryIndex(uint32_t index) const;
+    [[nodiscard]] uint32_t GetMaterialIndex(uint32_t index) const;
+    [[nodiscard]] uint32_t GetColor(uint32_t index) const { return m_Color[index]; }
+    [[nodiscard]] uint32_t GetParam(uint32_t index) const { return m_Param.empty() ? 0 : m_Param[index]; }
+    [[nodiscard]] float GetMaxDrawDistance(uint32_t index) const { return m_MaxDrawDistance.empty() ? 0.0f : m_MaxDrawDistance[index]; }
+
+private:
+    static constexpr size_t Alignment = xsimd::avx512f::alignment(); // widest dispatched arch
+    template <class T>
+    using Column = std::vector<T, xsimd::aligned_allocator<T, Alignment>>;
+
+    template <class T>
+    static void Permute(Column<T>& column, const std::vector<uint32_t>& order);
+
+    // position = Origin + q * Step, scale = q * ScaleStep, bound radius = scale + Padding
+    struct Block
+    {
+        float Origin[3]{};
+        float Step[3]{};
+        float ScaleStep = 0.0f;
+        float Padding = 0.0f;
+    };
+
+    // Quantizes the float columns and releases them, carried is per block the error already in them from
+    // earlier quantization, empty if none
+    void Encode(const std::vector<float>& carried);
+    void Decode();
+    // Chooses the block's frame from the given float data of its first count objects, extended by margin
+    // times its extent on each side, and quantizes them
+    void EncodeBlock(uint32_t block, uint32_t count, const float* x, const float* y, const float* z, const float* scale,
+        float carried, float margin);
+    [[nodiscard]] bool FitsBlock(uint32_t block, const StaticObject& object) const;
+    // bounds adds the block padding to the decoded radius
+    [[nodiscard]] CullingColumns GetQuantizedColumns(uint32_t begin, bool bounds) const;
+
+    uint32_t m_Size = 0;
+    bool m_Compact = false;
+
+    // hot
+    Column<float> m_PositionX{};
+    Column<float> m_PositionY{};
+    Column<float> m_PositionZ{};
+    Column<float> m_Scale{};
+
+    // cold
+    Column<float> m_RotationX{};
+    Column<float> m_RotationY{};
+    Column<float> m_RotationZ{};
+    Column<float> m_RotationW{};
+    Column<uint32_t> m_GeometryIndex{};
+    Column<uint32_t> m_MaterialIndex{};
+    Column<uint32_t> m_Color{};
+    // allocated on the first non zero value
+    Column<uint32_t> m_Param{};
+    Column<float> m_MaxDrawDistance{};
+
+    // compact, replace the float position, scale, rotation and id columns
+    Column<uint16_t> m_QuantizedX{};
+    Column<uint16_t> m_QuantizedY{};
+    Column<uint16_t> m_QuantizedZ{};
+    Column<uint16_t> m_QuantizedScale{};
+    Column<uint32_t> m_PackedRotation{};
+    Column<uint32_t> m_PackedIds{};
+    std::vector<Block> m_Blocks{};
+};
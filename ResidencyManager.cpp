@@ -0,0 +1,43 @@
+#include "ResidencyManager.h"
+
+#include <algorithm>
+#include <cassert>
+
+ResidencyManager::ResidencyManager(uint32_t cellCount) : m_Cells(cellCount)
+{
+}
+
+void ResidencyManager::Add(uint32_t cell, size_t bytes, uint64_t tick)
+{
+    Entry& entry = m_Cells[cell];
+    assert(!entry.Resident);
+    entry = { bytes, tick, true };
+    m_ResidentBytes += bytes;
+    ++m_ResidentCount;
+}
+
+void ResidencyManager::Remove(uint32_t cell)
+{
+    Entry& entry = m_Cells[cell];
+    if (!entry.Resident) return;
+    m_ResidentBytes -= entry.Bytes;
+    --m_ResidentCount;
+    entry = Entry();
+}
+
+void ResidencyManager::Touch(uint32_t cell, uint64_t tick)
+{
+    m_Cells[cell].LastVisible = tick;
+}
+
+void ResidencyManager::SelectVictims(uint32_t count, uint64_t visibleBefore, std::vector<uint32_t>& victims) const
+{
+    std::vector<std::pair<uint64_t, uint32_t>> candidates;
+    for (uint32_t cell = 0; cell < m_Cells.size(); ++cell)
+        if (m_Cells[cell].Resident && m_Cells[cell].LastVisible < visibleBefore)
+            candidates.emplace_back(m_Cells[cell].LastVisible, cell);
+
+    const size_t selected = std::min<size_t>(count, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + selected, candidates.end());
+    for (size_t i = 0; i < selected; ++i) victims.push_back(candidates[i].second);
+}
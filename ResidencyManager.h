@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct ResidencyStats
+{
+    size_t Budget = 0;
+    size_t Used = 0; // everything streaming holds: cell slots, BVHs, read buffers and staging stores of loads
+    size_t ResidentBytes = 0; // footprints of resident cells
+    uint32_t CellLimit = 0; // cells resident or loading at once the budget fits
+    uint32_t Evictions = 0; // since start
+};
+
+// Footprints and visibility of resident cells against a memory budget. Picks cells to evict least
+// recently visible first, the caller decides when and unloads them.
+class ResidencyManager
+{
+public:
+    explicit ResidencyManager(uint32_t cellCount);
+
+    void SetBudget(size_t bytes) { m_Budget = bytes; }
+    [[nodiscard]] size_t GetBudget() const { return m_Budget; }
+
+    // A new cell counts as visible at tick, so it isn't evicted before it had a chance to be seen
+    void Add(uint32_t cell, size_t bytes, uint64_t tick);
+    void Remove(uint32_t cell);
+    void Touch(uint32_t cell, uint64_t tick);
+
+    [[nodiscard]] size_t GetResidentBytes() const { return m_ResidentBytes; }
+    [[nodiscard]] uint32_t GetResidentCount() const { return m_ResidentCount; }
+
+    // Appends up to count resident cells last visible before tick to victims, least recently visible first
+    void SelectVictims(uint32_t count, uint64_t visibleBefore, std::vector<uint32_t>& victims) const;
+
+private:
+    struct Entry
+    {
+        size_t Bytes = 0;
+        uint64_t LastVisible = 0;
+        bool Resident = false;
+    };
+
+    std::vector<Entry> m_Cells{};
+    size_t m_Budget = 0;
+    size_t m_ResidentBytes = 0;
+    uint32_t m_ResidentCount = 0;
+};
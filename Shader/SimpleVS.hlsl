@@ -6,11 +6,13 @@ struct Vertex
 	float2 TexCoord;
 };
 
+// 32 bytes, packed on the CPU by Instance.h / InstancePacking.h
 struct Instance
 {
-	float4x4 World;
-	uint GeoIdx;
-	uint MatIdx;
+	float3 Position;
+	float Scale;
+	uint Rotation; // smallest three quaternion, 2 bit dropped index + 3 x 10 bits
+	uint Ids;      // geometry in the low 16 bits, material in the high 16 bits
 	uint Color;
 	uint Param;
 };
@@ -43,15 +45,35 @@ cbuffer PassConstants : register( b0 )
 StructuredBuffer<Vertex> g_Vertices : register( t0 );
 StructuredBuffer<Instance> g_Instances : register( t1 );
 
+float4 UnpackQuaternion(uint packed)
+{
+	const float halfSqrt2 = 0.70710678f;
+	const float3 v = float3((packed >> 20) & 0x3ff, (packed >> 10) & 0x3ff, packed & 0x3ff)
+		* (2.0f * halfSqrt2 / 1023.0f) - halfSqrt2;
+	const float dropped = sqrt(saturate(1.0f - dot(v, v)));
+
+	const uint largest = packed >> 30;
+	if (largest == 0) return float4(dropped, v);
+	if (largest == 1) return float4(v.x, dropped, v.yz);
+	if (largest == 2) return float4(v.xy, dropped, v.z);
+	return float4(v, dropped);
+}
+
+float3 Rotate(float3 v, float4 q)
+{
+	return v + 2.0f * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
 VertexOut main(uint vi : SV_VertexID, uint ii : SV_InstanceID)
 {
 	VertexOut vout;
 
 	const Instance inst = g_Instances[ii];
-	Vertex vert = g_Vertices[inst.GeoIdx * g_VertexPerMesh + vi];
+	Vertex vert = g_Vertices[(inst.Ids & 0xffff) * g_VertexPerMesh + vi];
 
-	float4 posW = mul(float4(vert.Position, 1.0f), inst.World);
-	const float3 normW = mul(vert.Normal, (float3x3)inst.World);
+	const float4 rotation = UnpackQuaternion(inst.Rotation);
+	float4 posW = float4(Rotate(vert.Position * inst.Scale, rotation) + inst.Position, 1.0f);
+	const float3 normW = Rotate(vert.Normal, rotation) * inst.Scale;
 	const float4 posH = mul(posW, g_ViewProj);
 
 	vout.PositionW = posW.xyz;
@@ -59,7 +81,7 @@ VertexOut main(uint vi : SV_VertexID, uint ii : SV_InstanceID)
 	vout.Normal = normW;
 	vout.Tangent = vert.Tangent;
 	vout.TexCoord = vert.TexCoord;
-	vout.MatIdx = inst.MatIdx;
+	vout.MatIdx = inst.Ids >> 16;
 	vout.Color = inst.Color;
 	vout.Param = inst.Param;
 
@@ -0,0 +1,54 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Bounded lock-free queue for one producer thread and one consumer thread
+template <class T>
+class SpscQueue
+{
+public:
+    // capacity is rounded up to a power of two
+    explicit SpscQueue(size_t capacity)
+    {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        m_Items.resize(size);
+        m_Mask = size - 1;
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // producer only, false when full
+    bool TryPush(const T& item)
+    {
+        const size_t tail = m_Tail.load(std::memory_order_relaxed);
+        if (tail - m_Head.load(std::memory_order_acquire) > m_Mask) return false;
+        m_Items[tail & m_Mask] = item;
+        m_Tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer only, false when empty
+    bool TryPop(T& item)
+    {
+        const size_t head = m_Head.load(std::memory_order_relaxed);
+        if (head == m_Tail.load(std::memory_order_acquire)) return false;
+        item = m_Items[head & m_Mask];
+        m_Head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    [[nodiscard]] bool IsEmpty() const
+    {
+        return m_Head.load(std::memory_order_acquire) == m_Tail.load(std::memory_order_acquire);
+    }
+
+private:
+    std::vector<T> m_Items{};
+    size_t m_Mask = 0;
+    // on their own cache lines, each is written by one side only
+    alignas(64) std::atomic<size_t> m_Head{ 0 };
+    alignas(64) std::atomic<size_t> m_Tail{ 0 };
+};
@@ -10,6 +10,7 @@ struct StaticObject
     uint32_t MaterialIndex{};
     uint32_t Color{};
     uint32_t Param{};
+    float MaxDrawDistance{}; // 0 uses the geometry's draw distance
 
     StaticObject() = default;
     StaticObject(DirectX::SimpleMath::Vector3 position, DirectX::SimpleMath::Quaternion rotation, float scale, uint32_t geometryIndex, uint32_t materialIndex, uint32_t color)
@@ -0,0 +1,320 @@
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <random>
+#include <vector>
+#include "Test.h"
+#include "CullingKernel.h"
+#include "CullingSoa.h"
+
+namespace
+{
+    constexpr uint32_t OBJECT_CAPACITY = 1024;
+    constexpr uint32_t COLUMN_OFFSET = 3; // columns start mid batch, so every kernel peels a scalar head
+    constexpr uint32_t OBJECT_COUNT = OBJECT_CAPACITY - COLUMN_OFFSET;
+
+    // 90 degree frustum looking down +z from Position, built from plain planes so the test doesn't
+    // depend on the view projection path
+    constexpr float Position[3] = { 10.0f, -5.0f, 20.0f };
+    constexpr float NEAR_PLANE = 1.0f;
+    constexpr float FAR_PLANE = 1000.0f;
+
+    CullingContext MakeContext()
+    {
+        const float s = 1.0f / std::sqrt(2.0f);
+        // outward normals, and a point on each plane relative to the camera
+        const float normals[6][3] = { { -s, 0, -s }, { s, 0, -s }, { 0, -s, -s }, { 0, s, -s }, { 0, 0, -1 }, { 0, 0, 1 } };
+        const float points[6] = { 0.0f, 0.0f, 0.0f, 0.0f, NEAR_PLANE, FAR_PLANE };
+
+        CullingContext context;
+        for (uint32_t p = 0; p < 6; ++p)
+        {
+            float w = 0.0f;
+            for (uint32_t k = 0; k < 3; ++k)
+            {
+                context.Planes[p][k] = normals[p][k];
+                context.AbsNormals[p][k] = std::abs(normals[p][k]);
+                w -= normals[p][k] * (Position[k] + (k == 2 ? points[p] : 0.0f));
+            }
+            context.Planes[p][3] = w;
+            for (uint32_t k = 0; k < 4; ++k)
+                std::fill_n(context.Splat[p][k], CullingContext::SplatWidth, context.Planes[p][k]);
+        }
+        std::copy_n(Position, 3, context.Position);
+        context.Forward[2] = 1.0f;
+        context.Near = NEAR_PLANE;
+        context.Far = FAR_PLANE;
+        return context;
+    }
+
+    // SoA columns with room for the widest batch alignment
+    struct Objects
+    {
+        enum Column { X, Y, Z, Radius, ExtentX, ExtentY, ExtentZ, RotationX, RotationY, RotationZ, RotationW, MaxDistanceSq, Count };
+        alignas(64) float Columns[Count][OBJECT_CAPACITY];
+
+        [[nodiscard]] CullingColumns GetColumns(bool box, bool limited) const
+        {
+            CullingColumns columns;
+            columns.PositionX = Columns[X] + COLUMN_OFFSET;
+            columns.PositionY = Columns[Y] + COLUMN_OFFSET;
+            columns.PositionZ = Columns[Z] + COLUMN_OFFSET;
+            columns.Radius = Columns[Radius] + COLUMN_OFFSET;
+            if (box)
+            {
+                columns.ExtentX = Columns[ExtentX] + COLUMN_OFFSET;
+                columns.ExtentY = Columns[ExtentY] + COLUMN_OFFSET;
+                columns.ExtentZ = Columns[ExtentZ] + COLUMN_OFFSET;
+                columns.RotationX = Columns[RotationX] + COLUMN_OFFSET;
+                columns.RotationY = Columns[RotationY] + COLUMN_OFFSET;
+                columns.RotationZ = Columns[RotationZ] + COLUMN_OFFSET;
+                columns.RotationW = Columns[RotationW] + COLUMN_OFFSET;
+            }
+            if (limited) columns.MaxDistanceSq = Columns[MaxDistanceSq] + COLUMN_OFFSET;
+            return columns;
+        }
+    };
+
+    // boxes inside their spheres, spread around the frustum so every plane cuts some of them
+    std::unique_ptr<Objects> MakeObjects(bool oriented)
+    {
+        auto objects = std::make_unique<Objects>();
+        auto& c = objects->Columns;
+        std::mt19937 gen(1234);
+        std::uniform_real_distribution<float> disXy(-700.0f, 700.0f);
+        std::uniform_real_distribution<float> disZ(-100.0f, 1100.0f);
+        std::uniform_real_distribution<float> disRadius(5.0f, 80.0f);
+        std::uniform_real_distribution<float> disShape(0.05f, 1.0f);
+        std::uniform_real_distribution<float> disDistance(100.0f, 1200.0f);
+        std::normal_distribution<float> disRotation;
+        for (uint32_t i = 0; i < OBJECT_CAPACITY; ++i)
+        {
+            c[Objects::X][i] = Position[0] + disXy(gen);
+            c[Objects::Y][i] = Position[1] + disXy(gen);
+            c[Objects::Z][i] = Position[2] + disZ(gen);
+            const float radius = c[Objects::Radius][i] = disRadius(gen);
+
+            float shape[3] = { disShape(gen), disShape(gen), disShape(gen) };
+            const float length = std::sqrt(shape[0] * shape[0] + shape[1] * shape[1] + shape[2] * shape[2]);
+            for (uint32_t k = 0; k < 3; ++k)
+                c[Objects::ExtentX + k][i] = radius * shape[k] / std::max(length, 1.0f);
+
+            float q[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+            if (oriented)
+            {
+                for (auto& v : q) v = disRotation(gen);
+                const float norm = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+                for (auto& v : q) v /= norm;
+            }
+            for (uint32_t k = 0; k < 4; ++k)
+                c[Objects::RotationX + k][i] = q[k];
+
+            const float distance = disDistance(gen);
+            c[Objects::MaxDistanceSq][i] = distance * distance;
+        }
+        return objects;
+    }
+
+    float PlaneDistance(const CullingContext& context, uint32_t p, const float point[3])
+    {
+        const auto& plane = context.Planes[p];
+        return plane[3] + point[0] * plane[0] + point[1] * plane[1] + point[2] * plane[2];
+    }
+
+    // reference tests written independently of the kernels, per object in column order
+    bool IsSphereVisible(const CullingContext& context, const Objects& objects, uint32_t i)
+    {
+        const auto& c = objects.Columns;
+        const float center[3] = { c[Objects::X][i], c[Objects::Y][i], c[Objects::Z][i] };
+        for (uint32_t p = 0; p < 6; ++p)
+            if (PlaneDistance(context, p, center) >= c[Objects::Radius][i]) return false;
+        return true;
+    }
+
+    // a box is outside a plane when all 8 corners are
+    bool IsBoxVisible(const CullingContext& context, const Objects& objects, uint32_t i)
+    {
+        const auto& c = objects.Columns;
+        const float q[3] = { c[Objects::RotationX][i], c[Objects::RotationY][i], c[Objects::RotationZ][i] };
+        const float w = c[Objects::RotationW][i];
+        float axes[3][3];
+        for (uint32_t a = 0; a < 3; ++a)
+        {
+            // v' = v + 2w (q x v) + 2 q x (q x v) of the unit axis, scaled by the extent
+            const float v[3] = { a == 0 ? 1.0f : 0.0f, a == 1 ? 1.0f : 0.0f, a == 2 ? 1.0f : 0.0f };
+            const float t[3] = { q[1] * v[2] - q[2] * v[1], q[2] * v[0] - q[0] * v[2], q[0] * v[1] - q[1] * v[0] };
+            const float u[3] = { q[1] * t[2] - q[2] * t[1], q[2] * t[0] - q[0] * t[2], q[0] * t[1] - q[1] * t[0] };
+            for (uint32_t k = 0; k < 3; ++k)
+                axes[a][k] = (v[k] + 2.0f * w * t[k] + 2.0f * u[k]) * c[Objects::ExtentX + a][i];
+        }
+
+        for (uint32_t p = 0; p < 6; ++p)
+        {
+            bool outside = true;
+            for (uint32_t corner = 0; corner < 8; ++corner)
+            {
+                float point[3];
+                for (uint32_t k = 0; k < 3; ++k)
+                {
+                    point[k] = c[Objects::X + k][i];
+                    for (uint32_t a = 0; a < 3; ++a)
+                        point[k] += (corner >> a & 1 ? 1.0f : -1.0f) * axes[a][k];
+                }
+                outside &= PlaneDistance(context, p, point) >= 0.0f;
+            }
+            if (outside) return false;
+        }
+        return true;
+    }
+
+    std::vector<uint32_t> Cull(CullingKernelTable::CullFn cull, const CullingColumns& columns, const CullingContext& context)
+    {
+        std::vector<uint32_t> visible(OBJECT_COUNT);
+        visible.resize(cull(columns, OBJECT_COUNT, context, COLUMN_OFFSET, visible.data()));
+        return visible;
+    }
+
+    std::vector<uint32_t> Reference(const std::function<bool(uint32_t)>& isVisible)
+    {
+        std::vector<uint32_t> visible;
+        for (uint32_t i = COLUMN_OFFSET; i < OBJECT_CAPACITY; ++i)
+            if (isVisible(i)) visible.push_back(i);
+        return visible;
+    }
+
+    // every ISA the CPU runs, the scalar table included
+    void ForEachIsa(const std::function<void(const CullingKernelTable&)>& test)
+    {
+        for (int isa = static_cast<int>(CullingIsa::Scalar); isa < static_cast<int>(CullingIsa::Count); ++isa)
+            if (CullingDispatcher::ForceIsa(static_cast<CullingIsa>(isa))) test(CullingDispatcher::GetKernels());
+        CullingDispatcher::ForceIsa(CullingIsa::Auto);
+    }
+}
+
+TEST_CASE(CullSpheresMatchesReference)
+{
+    const auto context = MakeContext();
+    const auto objects = MakeObjects(false);
+    const auto expected = Reference([&](uint32_t i) { return IsSphereVisible(context, *objects, i); });
+    CHECK(!expected.empty() && expected.size() < OBJECT_COUNT);
+    ForEachIsa([&](const CullingKernelTable& kernels)
+    {
+        CHECK(Cull(kernels.CullSpheres, objects->GetColumns(false, false), context) == expected);
+    });
+}
+
+TEST_CASE(CullObbsMatchesBoxReference)
+{
+    const auto context = MakeContext();
+    const auto objects = MakeObjects(true);
+    const auto spheres = Reference([&](uint32_t i) { return IsSphereVisible(context, *objects, i); });
+    const auto expected = Reference([&](uint32_t i) { return IsBoxVisible(context, *objects, i); });
+    // boxes lie inside their spheres, they only ever cull more
+    CHECK(expected.size() < spheres.size());
+    CHECK(std::includes(spheres.begin(), spheres.end(), expected.begin(), expected.end()));
+    ForEachIsa([&](const CullingKernelTable& kernels)
+    {
+        CHECK(Cull(kernels.CullObbs, objects->GetColumns(true, false), context) == expected);
+    });
+}
+
+TEST_CASE(CullAabbsMatchesBoxReference)
+{
+    const auto context = MakeContext();
+    const auto objects = MakeObjects(false);
+    const auto spheres = Reference([&](uint32_t i) { return IsSphereVisible(context, *objects, i); });
+    const auto expected = Reference([&](uint32_t i) { return IsBoxVisible(context, *objects, i); });
+    CHECK(expected.size() < spheres.size());
+    CHECK(std::includes(spheres.begin(), spheres.end(), expected.begin(), expected.end()));
+    ForEachIsa([&](const CullingKernelTable& kernels)
+    {
+        CHECK(Cull(kernels.CullAabbs, objects->GetColumns(true, false), context) == expected);
+        // an identity rotation takes the oriented path to the same answer
+        CHECK(Cull(kernels.CullObbs, objects->GetColumns(true, false), context) == expected);
+    });
+}
+
+TEST_CASE(ContributionCullingUsesViewDepth)
+{
+    auto context = MakeContext();
+    context.ContributionSq = 0.03f * 0.03f;
+    const auto objects = MakeObjects(false);
+    const auto& c = objects->Columns;
+    const auto expected = Reference([&](uint32_t i)
+    {
+        const float depth = std::max(c[Objects::Z][i] - Position[2], NEAR_PLANE);
+        return IsSphereVisible(context, *objects, i) && c[Objects::Radius][i] >= 0.03f * depth;
+    });
+    const auto unculled = Reference([&](uint32_t i) { return IsSphereVisible(context, *objects, i); });
+    CHECK(!expected.empty() && expected.size() < unculled.size());
+    ForEachIsa([&](const CullingKernelTable& kernels)
+    {
+        CHECK(Cull(kernels.CullSpheres, objects->GetColumns(false, false), context) == expected);
+    });
+
+    // off the view axis the distance is well above the depth, the object still covers its pixels
+    alignas(64) float x[1] = { Position[0] + 500.0f }, y[1] = { Position[1] }, z[1] = { Position[2] + 600.0f }, radius[1] = { 20.0f };
+    CullingColumns columns;
+    columns.PositionX = x;
+    columns.PositionY = y;
+    columns.PositionZ = z;
+    columns.Radius = radius;
+    ForEachIsa([&](const CullingKernelTable& kernels)
+    {
+        uint32_t visible[1];
+        CHECK(kernels.CullSpheres(columns, 1, context, 0, visible) == 1);
+    });
+}
+
+TEST_CASE(DrawDistanceMatchesReference)
+{
+    const auto context = MakeContext();
+    const auto objects = MakeObjects(true);
+    const auto& c = objects->Columns;
+    const auto inRange = [&](uint32_t i)
+    {
+        const float dx = c[Objects::X][i] - Position[0], dy = c[Objects::Y][i] - Position[1], dz = c[Objects::Z][i] - Position[2];
+        return dx * dx + dy * dy + dz * dz <= c[Objects::MaxDistanceSq][i];
+    };
+    const auto spheres = Reference([&](uint32_t i) { return IsSphereVisible(context, *objects, i) && inRange(i); });
+    const auto boxes = Reference([&](uint32_t i) { return IsBoxVisible(context, *objects, i) && inRange(i); });
+    const auto unlimited = Reference([&](uint32_t i) { return IsSphereVisible(context, *objects, i); });
+    CHECK(!spheres.empty() && spheres.size() < unlimited.size());
+    ForEachIsa([&](const CullingKernelTable& kernels)
+    {
+        CHECK(Cull(kernels.CullSpheres, objects->GetColumns(false, true), context) == spheres);
+        CHECK(Cull(kernels.CullObbs, objects->GetColumns(true, true), context) == boxes);
+    });
+}
+
+TEST_CASE(QuantizedDrawDistanceIsConservative)
+{
+    // centers right inside their draw distance, closer than the quantization step, the float path keeps
+    // them all and rounded centers must not push any of them out
+    const auto context = MakeContext();
+    const auto objects = MakeObjects(false);
+    const auto& c = objects->Columns;
+    constexpr uint32_t count = OBJECT_COUNT * 3; // more than one page
+    CullingSoa soa;
+    soa.Resize(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const uint32_t o = COLUMN_OFFSET + i % OBJECT_COUNT;
+        const DirectX::SimpleMath::Vector3 center(c[Objects::X][o], c[Objects::Y][o] + i / OBJECT_COUNT, c[Objects::Z][o]);
+        soa.Set(i, DirectX::BoundingSphere(center, c[Objects::Radius][o]));
+        const float dx = center.x - Position[0], dy = center.y - Position[1], dz = center.z - Position[2];
+        soa.SetDrawDistance(i, std::sqrt(dx * dx + dy * dy + dz * dz) + 1e-3f);
+    }
+
+    const std::vector<BvhObjectRange> ranges = { { 0, count, false } };
+    ForEachIsa([&](const CullingKernelTable&)
+    {
+        soa.SetQuantized(false);
+        const auto exact = soa.TickCulling(context, ranges);
+        soa.SetQuantized(true);
+        const auto quantized = soa.TickCulling(context, ranges);
+        CHECK(!exact.empty());
+        CHECK(std::includes(quantized.begin(), quantized.end(), exact.begin(), exact.end()));
+    });
+}
@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+#include "Test.h"
+#include "CullingKernel.h"
+#include "InstancePacking.h"
+
+namespace
+{
+    // half a quantization step per stored component, 1 / QuaternionScale apart
+    constexpr float COMPONENT_ERROR = 0.5f / InstancePacking::QuaternionScale + 1e-6f;
+    // the dropped component is at least 1/2, sqrt(1 - s) moves by at most sum |q_k| e / (1/2) <= 2 sqrt3 e
+    constexpr float LARGEST_ERROR = 3.5f * COMPONENT_ERROR;
+
+    std::vector<float> RandomQuaternions(uint32_t count)
+    {
+        std::mt19937 gen(42);
+        std::normal_distribution<float> dis;
+        std::vector<float> q(count * 4);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            float* v = &q[i * 4];
+            for (uint32_t k = 0; k < 4; ++k) v[k] = dis(gen);
+            const float norm = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2] + v[3] * v[3]);
+            for (uint32_t k = 0; k < 4; ++k) v[k] /= norm;
+        }
+        return q;
+    }
+
+    uint32_t GetDropped(uint32_t packed)
+    {
+        return packed >> InstancePacking::QuaternionBits * 3;
+    }
+}
+
+TEST_CASE(QuaternionRoundTripWithinErrorBound)
+{
+    const auto q = RandomQuaternions(10000);
+    for (size_t i = 0; i < q.size(); i += 4)
+    {
+        const uint32_t packed = InstancePacking::PackQuaternion(q[i], q[i + 1], q[i + 2], q[i + 3]);
+        float decoded[4];
+        InstancePacking::UnpackQuaternion(packed, decoded);
+
+        // decoded comes back with the dropped component positive, compare against the same hemisphere
+        const uint32_t dropped = GetDropped(packed);
+        const float sign = q[i + dropped] < 0.0f ? -1.0f : 1.0f;
+        for (uint32_t k = 0; k < 4; ++k)
+            CHECK(std::abs(decoded[k] - sign * q[i + k]) <= (k == dropped ? LARGEST_ERROR : COMPONENT_ERROR));
+    }
+}
+
+TEST_CASE(QuaternionSignDoesNotMatter)
+{
+    const auto q = RandomQuaternions(1000);
+    for (size_t i = 0; i < q.size(); i += 4)
+        CHECK(InstancePacking::PackQuaternion(q[i], q[i + 1], q[i + 2], q[i + 3]) ==
+            InstancePacking::PackQuaternion(-q[i], -q[i + 1], -q[i + 2], -q[i + 3]));
+}
+
+TEST_CASE(QuaternionTieDropsFirstLargest)
+{
+    const float h = InstancePacking::HalfSqrt2;
+    CHECK(GetDropped(InstancePacking::PackQuaternion(0.5f, 0.5f, 0.5f, 0.5f)) == 0);
+    CHECK(GetDropped(InstancePacking::PackQuaternion(0.5f, -0.5f, 0.5f, -0.5f)) == 0);
+    CHECK(GetDropped(InstancePacking::PackQuaternion(0.0f, h, h, 0.0f)) == 1);
+    CHECK(GetDropped(InstancePacking::PackQuaternion(0.0f, 0.0f, -h, h)) == 2);
+    CHECK(GetDropped(InstancePacking::PackQuaternion(0.0f, 0.0f, 0.0f, -1.0f)) == 3);
+
+    // a negative dropped component flips the others, so the tie still decodes to the same rotation
+    float decoded[4];
+    InstancePacking::UnpackQuaternion(InstancePacking::PackQuaternion(-0.5f, 0.5f, -0.5f, 0.5f), decoded);
+    const float expected[4] = { 0.5f, -0.5f, 0.5f, -0.5f };
+    for (uint32_t k = 0; k < 4; ++k)
+        CHECK(std::abs(decoded[k] - expected[k]) <= LARGEST_ERROR);
+}
+
+TEST_CASE(PackIdsClampsToSixteenBits)
+{
+    using namespace InstancePacking;
+    const uint32_t ids = PackIds(11, 31);
+    CHECK(UnpackGeometry(ids) == 11 && UnpackMaterial(ids) == 31);
+    CHECK(UnpackGeometry(PackIds(IdMax, 0)) == IdMax);
+
+    // out of range indices saturate instead of spilling into the other half
+    const uint32_t geometryOver = PackIds(IdMax + 7, 3);
+    CHECK(UnpackGeometry(geometryOver) == IdMax && UnpackMaterial(geometryOver) == 3);
+    const uint32_t materialOver = PackIds(5, 1u << 20);
+    CHECK(UnpackGeometry(materialOver) == 5 && UnpackMaterial(materialOver) == IdMax);
+    CHECK(PackIds(UINT32_MAX, UINT32_MAX) == UINT32_MAX);
+}
+
+TEST_CASE(SimdPackRotationsMatchesScalar)
+{
+    // not a multiple of any batch, so every kernel also runs its scalar tail
+    constexpr uint32_t count = 1021;
+    constexpr uint32_t outStride = 2;
+    const auto q = RandomQuaternions(count);
+    struct Columns
+    {
+        alignas(64) float Values[4][1024];
+    };
+    auto columns = std::make_unique<Columns>();
+    for (uint32_t i = 0; i < count; ++i)
+        for (uint32_t k = 0; k < 4; ++k)
+            columns->Values[k][i] = q[i * 4 + k];
+    // ties and negative largest components take the select chains through every branch
+    const float ties[4][4] = { { 0.5f, 0.5f, 0.5f, 0.5f }, { -0.5f, 0.5f, -0.5f, 0.5f },
+        { 0.0f, -InstancePacking::HalfSqrt2, InstancePacking::HalfSqrt2, 0.0f }, { 0.0f, 0.0f, 0.0f, -1.0f } };
+    for (uint32_t t = 0; t < 4; ++t)
+        for (uint32_t k = 0; k < 4; ++k)
+            columns->Values[k][t * 5] = ties[t][k];
+
+    RotationColumns rotations;
+    rotations.X = columns->Values[0];
+    rotations.Y = columns->Values[1];
+    rotations.Z = columns->Values[2];
+    rotations.W = columns->Values[3];
+
+    std::vector<uint32_t> expected(count);
+    for (uint32_t i = 0; i < count; ++i)
+        expected[i] = InstancePacking::PackQuaternion(rotations.X[i], rotations.Y[i], rotations.Z[i], rotations.W[i]);
+
+    for (int isa = static_cast<int>(CullingIsa::Scalar); isa < static_cast<int>(CullingIsa::Count); ++isa)
+    {
+        if (!CullingDispatcher::ForceIsa(static_cast<CullingIsa>(isa))) continue;
+        std::vector<uint32_t> out(count * outStride, 0xDEADBEEF);
+        CullingDispatcher::GetKernels().PackRotations(rotations, count, out.data(), outStride);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            CHECK(out[i * outStride] == expected[i]);
+            CHECK(out[i * outStride + 1] == 0xDEADBEEF);
+        }
+    }
+    CullingDispatcher::ForceIsa(CullingIsa::Auto);
+}
@@ -0,0 +1,63 @@
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <vector>
+#include "Test.h"
+#include "ObjectStore.h"
+
+using namespace DirectX;
+using namespace SimpleMath;
+
+namespace
+{
+    constexpr float SMALL_EXTENT = 1.0f;
+    constexpr float LARGE_EXTENT = 10000.0f;
+    constexpr uint32_t PERMUTE_COUNT = 5;
+
+    // the first block spread over a small area, the second over a large one
+    std::vector<StaticObject> MakeObjects()
+    {
+        std::mt19937 gen(42);
+        std::uniform_real_distribution<float> dis(0.0f, 1.0f);
+        std::vector<StaticObject> objects(2 * ObjectStore::BlockCapacity);
+        for (uint32_t i = 0; i < objects.size(); ++i)
+        {
+            const float extent = i < ObjectStore::BlockCapacity ? SMALL_EXTENT : LARGE_EXTENT;
+            objects[i] = StaticObject({ dis(gen) * extent, dis(gen) * extent, dis(gen) * extent }, Quaternion::Identity,
+                0.01f + dis(gen) * extent * 0.01f, 0, 0, 0);
+        }
+        return objects;
+    }
+
+    bool Contains(const ObjectStore& store, uint32_t index, const StaticObject& object)
+    {
+        const BoundingSphere bound = store.GetBound(index);
+        return Vector3::Distance(bound.Center, object.Position) + object.Scale <= bound.Radius * (1.0f + 1e-5f);
+    }
+}
+
+TEST_CASE(PermuteKeepsPaddingPerBlock)
+{
+    const auto objects = MakeObjects();
+    ObjectStore store;
+    store.Resize(static_cast<uint32_t>(objects.size()));
+    for (uint32_t i = 0; i < objects.size(); ++i) store.Set(i, objects[i]);
+    store.SetCompact(true);
+
+    const float small = store.GetBoundPadding(0);
+    const float large = store.GetBoundPadding(ObjectStore::BlockCapacity);
+    CHECK(small * 100.0f < large);
+
+    // objects stay in their blocks, so the small block only accumulates its own requantization error
+    std::vector<uint32_t> order(objects.size());
+    std::iota(order.begin(), order.end(), 0);
+    for (uint32_t pass = 0; pass < PERMUTE_COUNT; ++pass) store.Permute(order);
+    CHECK(store.GetBoundPadding(0) <= small * (PERMUTE_COUNT + 1));
+    CHECK(store.GetBoundPadding(0) * 100.0f < store.GetBoundPadding(ObjectStore::BlockCapacity));
+    for (uint32_t i = 0; i < objects.size(); ++i) CHECK(Contains(store, i, objects[i]));
+
+    // a block taking objects from the large one carries its error
+    std::swap(order[0], order[ObjectStore::BlockCapacity]);
+    store.Permute(order);
+    CHECK(store.GetBoundPadding(0) >= large);
+}
@@ -0,0 +1,29 @@
+#pragma once
+// Minimal self registering test cases, TestMain.cpp runs them all and returns non zero on any failure
+#include <vector>
+
+namespace Test
+{
+    struct Case
+    {
+        const char* Name;
+        void (*Run)();
+    };
+
+    std::vector<Case>& GetCases();
+    void Fail(const char* file, int line, const char* expression);
+
+    struct Registrar
+    {
+        Registrar(const char* name, void (*run)()) { GetCases().push_back({ name, run }); }
+    };
+}
+
+#define TEST_CASE(name) \
+    static void name(); \
+    static const Test::Registrar name##Registrar(#name, &name); \
+    static void name()
+
+// records the failure and keeps going, so one run reports every broken check
+#define CHECK(expression) \
+    do { if (!(expression)) Test::Fail(__FILE__, __LINE__, #expression); } while (false)
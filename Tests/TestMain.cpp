@@ -0,0 +1,35 @@
+#include <cstdint>
+#include <cstdio>
+#include "Test.h"
+
+namespace
+{
+    uint32_t s_Failures = 0;
+}
+
+std::vector<Test::Case>& Test::GetCases()
+{
+    static std::vector<Case> cases;
+    return cases;
+}
+
+void Test::Fail(const char* file, int line, const char* expression)
+{
+    std::printf("%s(%d): check failed: %s\n", file, line, expression);
+    ++s_Failures;
+}
+
+int main()
+{
+    uint32_t failedCases = 0;
+    for (const auto& test : Test::GetCases())
+    {
+        const uint32_t before = s_Failures;
+        test.Run();
+        const bool passed = s_Failures == before;
+        failedCases += !passed;
+        std::printf("[%s] %s\n", passed ? "pass" : "FAIL", test.Name);
+    }
+    std::printf("%zu cases, %u failed\n", Test::GetCases().size(), failedCases);
+    return failedCases == 0 ? 0 : 1;
+}
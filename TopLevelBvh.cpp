@@ -0,0 +1,124 @@
+#include "TopLevelBvh.h"
+
+#include <algorithm>
+#include <stack>
+
+using namespace DirectX;
+using namespace SimpleMath;
+
+namespace
+{
+    float MergeDrawDistance(const BvhLinearNode& child, const BoundingSphere& bound)
+    {
+        return child.MaxDrawDistance < FLT_MAX ? child.MaxDrawDistance + Vector3::Distance(child.Bound.Center, bound.Center) : FLT_MAX;
+    }
+}
+
+void TopLevelBvh::Build(std::vector<Leaf> leaves)
+{
+    m_Nodes.clear();
+    m_SlotNodes.clear();
+    if (leaves.empty()) return;
+
+    uint32_t slotCount = 0;
+    for (const auto& leaf : leaves) slotCount = std::max(slotCount, leaf.Slot + 1);
+    m_SlotNodes.assign(slotCount, UINT32_MAX);
+    m_Nodes.reserve(leaves.size() * 2 - 1);
+    Build(leaves, 0, static_cast<uint32_t>(leaves.size()));
+}
+
+uint32_t TopLevelBvh::Build(std::vector<Leaf>& leaves, uint32_t begin, uint32_t end)
+{
+    const auto index = static_cast<uint32_t>(m_Nodes.size());
+    m_Nodes.emplace_back();
+    if (end - begin == 1)
+    {
+        BvhLinearNode& node = m_Nodes[index];
+        node.Bound = leaves[begin].Bound;
+        node.ObjectOffset = leaves[begin].Slot;
+        node.ObjectCount = 1;
+        node.MaxDrawDistance = leaves[begin].MaxDrawDistance;
+        m_SlotNodes[leaves[begin].Slot] = index;
+        return index;
+    }
+
+    // cells are spread over the grid, halving along the longer centre extent keeps siblings neighbours
+    Vector3 min = leaves[begin].Bound.Center, max = min;
+    for (uint32_t i = begin + 1; i < end; ++i)
+    {
+        min = Vector3::Min(min, leaves[i].Bound.Center);
+        max = Vector3::Max(max, leaves[i].Bound.Center);
+    }
+    const Vector3 extent = max - min;
+    const int axis = extent.x > extent.y && extent.x > extent.z ? 0 : extent.y > extent.z ? 1 : 2;
+    const uint32_t mid = (begin + end) / 2;
+    std::nth_element(leaves.begin() + begin, leaves.begin() + mid, leaves.begin() + end,
+        [axis](const Leaf& a, const Leaf& b)
+        {
+            return (&a.Bound.Center.x)[axis] < (&b.Bound.Center.x)[axis];
+        });
+
+    Build(leaves, begin, mid);
+    const uint32_t second = Build(leaves, mid, end);
+    // m_Nodes may have grown, the node is only touched once the children are in
+    BvhLinearNode& node = m_Nodes[index];
+    node.SecondChildOffset = second;
+    node.ObjectCount = 0;
+    BoundingSphere::CreateMerged(node.Bound, m_Nodes[index + 1].Bound, m_Nodes[second].Bound);
+    node.MaxDrawDistance = std::max(MergeDrawDistance(m_Nodes[index + 1], node.Bound), MergeDrawDistance(m_Nodes[second], node.Bound));
+    return index;
+}
+
+void TopLevelBvh::SetLeaf(uint32_t slot, const BoundingSphere& bound, float maxDrawDistance)
+{
+    if (slot >= m_SlotNodes.size() || m_SlotNodes[slot] == UINT32_MAX) return;
+    BvhLinearNode& node = m_Nodes[m_SlotNodes[slot]];
+    node.Bound = bound;
+    node.MaxDrawDistance = maxDrawDistance;
+}
+
+void TopLevelBvh::Refit()
+{
+    // children are always stored after their parent, so a reverse sweep sees them first
+    for (uint32_t i = static_cast<uint32_t>(m_Nodes.size()); i-- > 0;)
+    {
+        BvhLinearNode& node = m_Nodes[i];
+        if (node.ObjectCount > 0) continue;
+        const BvhLinearNode& first = m_Nodes[i + 1];
+        const BvhLinearNode& second = m_Nodes[node.SecondChildOffset];
+        BoundingSphere::CreateMerged(node.Bound, first.Bound, second.Bound);
+        node.MaxDrawDistance = std::max(MergeDrawDistance(first, node.Bound), MergeDrawDistance(second, node.Bound));
+    }
+}
+
+void TopLevelBvh::Cull(const CullingContext& context, std::vector<std::pair<uint32_t, bool>>& slots,
+    uint32_t& nodesVisited) const
+{
+    if (m_Nodes.empty()) return;
+
+    std::stack<std::pair<uint32_t, bool>> toVisit;
+    toVisit.emplace(0, false);
+    while (!toVisit.empty())
+    {
+        const auto [nodeIdx, parentContained] = toVisit.top();
+        const BvhLinearNode& node = m_Nodes[nodeIdx];
+        toVisit.pop();
+        ++nodesVisited;
+
+        // below a contained node only the projected size and draw distance can still reject
+        const auto contain = parentContained && !context.HasContributionCulling() && node.MaxDrawDistance == FLT_MAX ?
+            CullingContext::Containment::Contains : context.Test(node.Bound, node.MaxDrawDistance);
+        if (contain == CullingContext::Containment::Disjoint) continue;
+
+        const bool contained = parentContained || contain == CullingContext::Containment::Contains;
+        if (node.ObjectCount > 0)
+        {
+            slots.emplace_back(node.ObjectOffset, contained);
+        }
+        else
+        {
+            toVisit.emplace(node.SecondChildOffset, contained);
+            toVisit.emplace(nodeIdx + 1, contained);
+        }
+    }
+}
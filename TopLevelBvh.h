@@ -0,0 +1,36 @@
+#pragma once
+#include <vector>
+#include <directxtk/SimpleMath.h>
+#include "BvhTree.h"
+#include "CullingContext.h"
+
+// BVH over the root bounds of resident cells, each leaf is one cell slot. It holds a node or two per cell,
+// so it is rebuilt whenever cells come or go and refit when they change in place, while the cell trees
+// below it are built once per load.
+class TopLevelBvh
+{
+public:
+    struct Leaf
+    {
+        uint32_t Slot = 0;
+        DirectX::BoundingSphere Bound{};
+        float MaxDrawDistance = FLT_MAX; // see BvhLinearNode
+    };
+
+    void Build(std::vector<Leaf> leaves);
+    // Sets the bound of a slot's leaf, the tree is stale until Refit
+    void SetLeaf(uint32_t slot, const DirectX::BoundingSphere& bound, float maxDrawDistance);
+    void Refit();
+
+    // Appends visible slots and whether they are contained, in tree order
+    void Cull(const CullingContext& context, std::vector<std::pair<uint32_t, bool>>& slots, uint32_t& nodesVisited) const;
+
+    [[nodiscard]] const std::vector<BvhLinearNode>& GetTree() const { return m_Nodes; }
+
+private:
+    // flattens leaves [begin, end) depth first, returns the node index
+    uint32_t Build(std::vector<Leaf>& leaves, uint32_t begin, uint32_t end);
+
+    std::vector<BvhLinearNode> m_Nodes{}; // leaves hold their slot in ObjectOffset and count 1
+    std::vector<uint32_t> m_SlotNodes{}; // per slot, its leaf or UINT32_MAX
+};
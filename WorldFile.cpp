@@ -0,0 +1,288 @@
+#include "WorldFile.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+#include "LzCodec.h"
+
+namespace
+{
+    constexpr uint32_t ColumnCount = static_cast<uint32_t>(ObjectColumn::Count);
+    constexpr uint32_t TableSize = ColumnCount + 1; // the BVH follows the columns
+
+    uint64_t AlignUp(uint64_t offset)
+    {
+        return (offset + WorldFile::Alignment - 1) / WorldFile::Alignment * WorldFile::Alignment;
+    }
+
+    void Pad(std::ofstream& file, uint64_t offset)
+    {
+        static constexpr char zeros[WorldFile::Alignment] = {};
+        file.write(zeros, static_cast<std::streamsize>(AlignUp(offset) - offset));
+    }
+
+    // byte b of value i goes to plane b
+    void Shuffle(const uint8_t* values, uint32_t count, uint8_t* planes)
+    {
+        for (uint32_t i = 0; i < count; ++i)
+            for (uint32_t b = 0; b < sizeof(float); ++b)
+                planes[b * count + i] = values[i * sizeof(float) + b];
+    }
+
+    void Unshuffle(const uint8_t* planes, uint32_t count, uint8_t* values)
+    {
+        for (uint32_t i = 0; i < count; ++i)
+            for (uint32_t b = 0; b < sizeof(float); ++b)
+                values[i * sizeof(float) + b] = planes[b * count + i];
+    }
+
+    void ExtendBounds(const DirectX::BoundingSphere& sphere, float* min, float* max)
+    {
+        const float center[3] = { sphere.Center.x, sphere.Center.y, sphere.Center.z };
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            min[axis] = std::min(min[axis], center[axis] - sphere.Radius);
+            max[axis] = std::max(max[axis], center[axis] + sphere.Radius);
+        }
+    }
+}
+
+WorldFile::WorldFile(const std::filesystem::path& path) : m_File(path)
+{
+    const auto fail = [&path](const char* reason) { throw std::runtime_error(path.string() + ": " + reason); };
+
+    if (m_File.GetSize() < sizeof(WorldFileHeader)) fail("not a world file");
+    m_Header = reinterpret_cast<const WorldFileHeader*>(m_File.GetData());
+    if (m_Header->Magic != Magic) fail("not a world file");
+    if (m_Header->Version != Version) fail("unsupported world file version");
+
+    const uint64_t cellCount = static_cast<uint64_t>(m_Header->CellsX) * m_Header->CellsZ;
+    if (m_Header->CellTableOffset % alignof(WorldFileCell) != 0 ||
+        m_Header->CellTableOffset + cellCount * sizeof(WorldFileCell) > m_File.GetSize())
+        fail("truncated cell table");
+    m_Cells = reinterpret_cast<const WorldFileCell*>(m_File.GetData() + m_Header->CellTableOffset);
+
+    // checked once here, so ReadCell can copy without looking
+    for (uint64_t cell = 0; cell < cellCount; ++cell)
+    {
+        const WorldFileCell& entry = m_Cells[cell];
+        if (entry.ObjectCount == 0) continue;
+        if (entry.ObjectCount > m_Header->MaxCellObjects || entry.Size > m_Header->MaxCellBytes ||
+            entry.Offset % Alignment != 0 || entry.Size < sizeof(WorldFileColumn) * TableSize ||
+            entry.Offset + entry.Size > m_File.GetSize())
+            fail("truncated cell");
+        const auto* columns = reinterpret_cast<const WorldFileColumn*>(m_File.GetData() + entry.Offset);
+        for (uint32_t column = 0; column < ColumnCount; ++column)
+        {
+            const bool optional = column == static_cast<uint32_t>(ObjectColumn::Param) ||
+                column == static_cast<uint32_t>(ObjectColumn::MaxDrawDistance);
+            if ((columns[column].Offset == 0 && !optional) ||
+                columns[column].Size > uint64_t{ entry.ObjectCount } * sizeof(float) ||
+                uint64_t{ columns[column].Offset } + columns[column].Size > entry.Size)
+                fail("corrupt cell");
+        }
+        const WorldFileColumn& bvh = columns[ColumnCount];
+        if (bvh.Offset % alignof(WorldFileBvhNode) != 0 || bvh.Size % sizeof(WorldFileBvhNode) != 0 ||
+            uint64_t{ bvh.Offset } + bvh.Size > entry.Size)
+            fail("corrupt cell");
+    }
+}
+
+void WorldFile::Write(const std::filesystem::path& path, const WorldGrid& grid, const ObjectStore& objects,
+    uint32_t maxObjInNode, BvhTree::SpitMethod method)
+{
+    std::vector<std::vector<uint32_t>> members(grid.GetCellCount());
+    for (uint32_t i = 0; i < objects.GetSize(); ++i)
+        members[grid.GetCell(objects.GetPosition(i))].push_back(i);
+
+    WorldFileHeader header{};
+    header.Magic = Magic;
+    header.Version = Version;
+    header.OriginX = grid.Origin.x;
+    header.OriginZ = grid.Origin.y;
+    header.CellSize = grid.CellSize;
+    header.CellsX = grid.CellsX;
+    header.CellsZ = grid.CellsZ;
+    header.ObjectCount = objects.GetSize();
+    header.BvhMaxObjInNode = maxObjInNode;
+    header.BvhMethod = static_cast<uint32_t>(method);
+    std::fill_n(header.BoundsMin, 3, FLT_MAX);
+    std::fill_n(header.BoundsMax, 3, -FLT_MAX);
+    header.CellTableOffset = AlignUp(sizeof(WorldFileHeader));
+
+    std::vector<WorldFileCell> cells(grid.GetCellCount());
+    uint64_t offset = AlignUp(header.CellTableOffset + cells.size() * sizeof(WorldFileCell));
+
+    const auto temporary = std::filesystem::path(path).concat(".tmp");
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file) throw std::runtime_error("can't write " + temporary.string());
+
+        // header and cell table are rewritten once the cells are placed
+        file.seekp(static_cast<std::streamoff>(offset));
+        for (uint32_t cell = 0; cell < cells.size(); ++cell)
+        {
+            WorldFileCell& entry = cells[cell];
+            std::fill_n(entry.BoundsMin, 3, FLT_MAX);
+            std::fill_n(entry.BoundsMax, 3, -FLT_MAX);
+            entry.ObjectCount = static_cast<uint32_t>(members[cell].size());
+            header.MaxCellObjects = std::max(header.MaxCellObjects, entry.ObjectCount);
+            if (entry.ObjectCount == 0) continue;
+
+            ObjectStore store;
+            store.Resize(entry.ObjectCount);
+            for (uint32_t i = 0; i < entry.ObjectCount; ++i) store.Set(i, objects.Get(members[cell][i]));
+            const BvhTree bvh(store, maxObjInNode, method);
+            for (uint32_t i = 0; i < entry.ObjectCount; ++i) ExtendBounds(store.GetBound(i), entry.BoundsMin, entry.BoundsMax);
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                header.BoundsMin[axis] = std::min(header.BoundsMin[axis], entry.BoundsMin[axis]);
+                header.BoundsMax[axis] = std::max(header.BoundsMax[axis], entry.BoundsMax[axis]);
+            }
+
+            // columns are encoded first, the table in front of them needs their sizes
+            const uint32_t rawSize = entry.ObjectCount * sizeof(float);
+            std::vector<uint8_t> planes(rawSize);
+            std::vector<uint8_t> compressed(LzCodec::GetMaxCompressedSize(rawSize));
+            std::vector<uint8_t> payload;
+            WorldFileColumn columns[TableSize] = {};
+            for (uint32_t column = 0; column < ColumnCount; ++column)
+            {
+                const auto* data = static_cast<const uint8_t*>(store.GetColumnData(static_cast<ObjectColumn>(column)));
+                if (data == nullptr) continue;
+                Shuffle(data, entry.ObjectCount, planes.data());
+                const auto size = static_cast<uint32_t>(LzCodec::Compress(planes.data(), rawSize, compressed.data()));
+                columns[column].Offset = static_cast<uint32_t>(sizeof(columns) + payload.size());
+                if (size < rawSize)
+                {
+                    columns[column].Size = size;
+                    payload.insert(payload.end(), compressed.begin(), compressed.begin() + size);
+                }
+                else
+                {
+                    columns[column].Size = rawSize;
+                    payload.insert(payload.end(), data, data + rawSize);
+                }
+            }
+            payload.resize(AlignUp(sizeof(columns) + payload.size()) - sizeof(columns));
+            columns[ColumnCount].Offset = static_cast<uint32_t>(sizeof(columns) + payload.size());
+            columns[ColumnCount].Size = static_cast<uint32_t>(bvh.GetTree().size() * sizeof(WorldFileBvhNode));
+            for (const BvhLinearNode& node : bvh.GetTree())
+            {
+                const WorldFileBvhNode stored = { { node.Bound.Center.x, node.Bound.Center.y, node.Bound.Center.z },
+                    node.Bound.Radius, node.ObjectOffset, node.ObjectCount };
+                const auto* bytes = reinterpret_cast<const uint8_t*>(&stored);
+                payload.insert(payload.end(), bytes, bytes + sizeof(stored));
+            }
+
+            entry.Offset = offset;
+            entry.Size = static_cast<uint32_t>(sizeof(columns) + payload.size());
+            header.MaxCellBytes = std::max(header.MaxCellBytes, entry.Size);
+            file.write(reinterpret_cast<const char*>(columns), sizeof(columns));
+            file.write(reinterpret_cast<const char*>(payload.data()), static_cast<std::streamsize>(payload.size()));
+            Pad(file, entry.Size);
+            offset += AlignUp(entry.Size);
+        }
+
+        file.seekp(0);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        Pad(file, sizeof(header));
+        file.write(reinterpret_cast<const char*>(cells.data()), static_cast<std::streamsize>(cells.size() * sizeof(WorldFileCell)));
+        if (!file) throw std::runtime_error("can't write " + temporary.string());
+    }
+    std::filesystem::rename(temporary, path);
+}
+
+bool WorldFile::IsValid(const std::filesystem::path& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    WorldFileHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    return file && header.Magic == Magic && header.Version == Version;
+}
+
+WorldGrid WorldFile::GetGrid() const
+{
+    WorldGrid grid;
+    grid.Origin = DirectX::SimpleMath::Vector2(m_Header->OriginX, m_Header->OriginZ);
+    grid.CellSize = m_Header->CellSize;
+    grid.CellsX = m_Header->CellsX;
+    grid.CellsZ = m_Header->CellsZ;
+    return grid;
+}
+
+bool WorldFile::ReadCell(uint32_t cell, ObjectStore& objects) const
+{
+    const uint8_t* block = m_File.GetData() + m_Cells[cell].Offset;
+    PrepareCell(cell, block, objects);
+    bool succeeded = true;
+    for (uint32_t column = 0; column < ColumnCount; ++column)
+        succeeded &= DecodeColumn(cell, block, static_cast<ObjectColumn>(column), objects);
+    return succeeded;
+}
+
+void WorldFile::PrepareCell(uint32_t cell, const uint8_t* block, ObjectStore& objects) const
+{
+    const WorldFileCell& entry = m_Cells[cell];
+    if (entry.ObjectCount == 0)
+    {
+        objects.AllocateColumns(0, false, false);
+        return;
+    }
+
+    const auto* columns = reinterpret_cast<const WorldFileColumn*>(block);
+    objects.AllocateColumns(entry.ObjectCount, columns[static_cast<uint32_t>(ObjectColumn::Param)].Offset != 0,
+        columns[static_cast<uint32_t>(ObjectColumn::MaxDrawDistance)].Offset != 0);
+}
+
+bool WorldFile::DecodeColumn(uint32_t cell, const uint8_t* block, ObjectColumn column, ObjectStore& objects) const
+{
+    const WorldFileCell& entry = m_Cells[cell];
+    if (entry.ObjectCount == 0) return true;
+
+    const WorldFileColumn& stored = reinterpret_cast<const WorldFileColumn*>(block)[static_cast<uint32_t>(column)];
+    if (stored.Offset == 0) return true;
+
+    auto* values = static_cast<uint8_t*>(objects.GetColumnData(column));
+    const uint32_t rawSize = entry.ObjectCount * sizeof(float);
+    if (stored.Size == rawSize)
+    {
+        std::copy_n(block + stored.Offset, rawSize, values);
+        return true;
+    }
+
+    // per thread, so columns decode in parallel without allocating
+    thread_local std::vector<uint8_t> planes;
+    planes.resize(rawSize);
+    if (!LzCodec::Decompress(block + stored.Offset, stored.Size, planes.data(), rawSize)) return false;
+    Unshuffle(planes.data(), entry.ObjectCount, values);
+    return true;
+}
+
+bool WorldFile::DecodeBvh(uint32_t cell, const uint8_t* block, std::vector<BvhLinearNode>& nodes) const
+{
+    nodes.clear();
+    const WorldFileCell& entry = m_Cells[cell];
+    if (entry.ObjectCount == 0) return true;
+
+    const WorldFileColumn& stored = reinterpret_cast<const WorldFileColumn*>(block)[ColumnCount];
+    const auto count = static_cast<uint32_t>(stored.Size / sizeof(WorldFileBvhNode));
+    if (count == 0) return false;
+    const auto* source = reinterpret_cast<const WorldFileBvhNode*>(block + stored.Offset);
+
+    // traversal trusts the links, children must come after their parent and leaves stay in the cell
+    nodes.resize(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const WorldFileBvhNode& node = source[i];
+        if (node.ObjectCount > 0 ? uint64_t{ node.Offset } + node.ObjectCount > entry.ObjectCount :
+            i + 1 >= count || node.Offset <= i + 1 || node.Offset >= count)
+            return false;
+        nodes[i].Bound = DirectX::BoundingSphere(DirectX::XMFLOAT3(node.Center[0], node.Center[1], node.Center[2]), node.Radius);
+        nodes[i].ObjectOffset = node.Offset;
+        nodes[i].ObjectCount = node.ObjectCount;
+    }
+    return true;
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include "BvhTree.h"
+#include "MappedFile.h"
+#include "ObjectStore.h"
+#include "WorldGrid.h"
+
+// World file layout, little endian:
+//   WorldFileHeader
+//   WorldFileCell per grid cell, at CellTableOffset
+//   a block of Size bytes per non empty cell at its Offset, Alignment aligned: a WorldFileColumn per
+//   ObjectColumn and one for the BVH, then the columns in BVH order, then the BVH's WorldFileBvhNodes.
+// Columns hold ObjectStore's float mode values. Each is compressed on its own, its bytes split into four
+// planes (the high bytes of floats and small ints repeat, so they compress well) and LzCodec compressed,
+// unless that doesn't make it smaller. Columns decode independently, straight into the store.
+// The BVH is stored as built, cells loaded with the settings in the header take it instead of building
+// their own. Blocks can be read on their own, see AsyncReader, or through the mapping.
+struct WorldFileHeader
+{
+    uint32_t Magic;
+    uint32_t Version;
+    float OriginX;
+    float OriginZ;
+    float CellSize;
+    uint32_t CellsX;
+    uint32_t CellsZ;
+    uint32_t ObjectCount;
+    uint32_t MaxCellObjects;
+    float BoundsMin[3]; // of every object's bounding sphere
+    float BoundsMax[3];
+    uint32_t MaxCellBytes; // size of the largest cell block
+    uint32_t BvhMaxObjInNode; // settings the cell BVHs were built with
+    uint32_t BvhMethod;
+    uint64_t CellTableOffset;
+};
+static_assert(sizeof(WorldFileHeader) == 80);
+
+struct WorldFileCell
+{
+    uint64_t Offset; // of the cell's block, 0 when empty
+    uint32_t ObjectCount;
+    uint32_t Size; // of the block in bytes
+    float BoundsMin[3]; // min > max when empty
+    float BoundsMax[3];
+};
+static_assert(sizeof(WorldFileCell) == 40);
+
+struct WorldFileColumn
+{
+    uint32_t Offset; // relative to the block, 0 for absent columns
+    uint32_t Size; // stored bytes, compressed when less than 4 per object
+};
+
+// BvhLinearNode without the draw distance, that is refit once the cell is in
+struct WorldFileBvhNode
+{
+    float Center[3];
+    float Radius;
+    uint32_t Offset; // first object relative to the cell for leaves, second child otherwise
+    uint32_t ObjectCount; // 0 for interior nodes
+};
+static_assert(sizeof(WorldFileBvhNode) == 24);
+
+// A world file mapped for reading, cells can be read from any thread
+class WorldFile
+{
+public:
+    static constexpr uint32_t Magic = 0x444c5257; // "WRLD"
+    static constexpr uint32_t Version = 4;
+    static constexpr uint32_t Alignment = 64;
+
+    // throws std::runtime_error if the file is missing, of another version or truncated
+    explicit WorldFile(const std::filesystem::path& path);
+
+    // Partitions objects into the cells of grid, builds a BVH per cell with the given settings and
+    // writes path. The file is written under a temporary name first, readers never see half a world.
+    static void Write(const std::filesystem::path& path, const WorldGrid& grid, const ObjectStore& objects,
+        uint32_t maxObjInNode, BvhTree::SpitMethod method);
+    // whether path holds a world of this version
+    [[nodiscard]] static bool IsValid(const std::filesystem::path& path);
+
+    [[nodiscard]] const WorldFileHeader& GetHeader() const { return *m_Header; }
+    [[nodiscard]] WorldGrid GetGrid() const;
+    [[nodiscard]] const WorldFileCell& GetCell(uint32_t cell) const { return m_Cells[cell]; }
+
+    // Replaces objects with the cell's, BVH ordered, read through the mapping. False on corrupt data.
+    [[nodiscard]] bool ReadCell(uint32_t cell, ObjectStore& objects) const;
+
+    // Decoding in parts, from the cell's block read to memory elsewhere: PrepareCell sizes objects
+    // for the cell, then every column is decoded, in any order and on any thread
+    void PrepareCell(uint32_t cell, const uint8_t* block, ObjectStore& objects) const;
+    // false on corrupt data, true for absent columns
+    [[nodiscard]] bool DecodeColumn(uint32_t cell, const uint8_t* block, ObjectColumn column, ObjectStore& objects) const;
+    // Replaces nodes with the cell's stored BVH, false if it is corrupt
+    [[nodiscard]] bool DecodeBvh(uint32_t cell, const uint8_t* block, std::vector<BvhLinearNode>& nodes) const;
+
+private:
+    MappedFile m_File;
+    const WorldFileHeader* m_Header = nullptr;
+    const WorldFileCell* m_Cells = nullptr;
+};
@@ -0,0 +1,40 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <directxtk/SimpleMath.h>
+
+// Square cells over the XZ plane, each spanning the full height of the world. Cells are the unit of streaming.
+struct WorldGrid
+{
+    DirectX::SimpleMath::Vector2 Origin{}; // min x and z
+    float CellSize = 1.0f;
+    uint32_t CellsX = 0;
+    uint32_t CellsZ = 0;
+
+    [[nodiscard]] uint32_t GetCellCount() const { return CellsX * CellsZ; }
+
+    // positions outside the grid map to the nearest border cell
+    [[nodiscard]] uint32_t GetCell(const DirectX::SimpleMath::Vector3& position) const
+    {
+        const auto clampCell = [this](float offset, uint32_t count)
+        {
+            return static_cast<uint32_t>(std::clamp(offset / CellSize, 0.0f, static_cast<float>(count - 1)));
+        };
+        return clampCell(position.z - Origin.y, CellsZ) * CellsX + clampCell(position.x - Origin.x, CellsX);
+    }
+
+    [[nodiscard]] DirectX::SimpleMath::Vector2 GetCellMin(uint32_t cell) const
+    {
+        return { Origin.x + static_cast<float>(cell % CellsX) * CellSize, Origin.y + static_cast<float>(cell / CellsX) * CellSize };
+    }
+
+    // distance in the XZ plane from position to the cell's footprint, 0 inside
+    [[nodiscard]] float GetDistance(uint32_t cell, const DirectX::SimpleMath::Vector3& position) const
+    {
+        const auto min = GetCellMin(cell);
+        const float dx = std::max({ min.x - position.x, 0.0f, position.x - min.x - CellSize });
+        const float dz = std::max({ min.y - position.z, 0.0f, position.z - min.y - CellSize });
+        return std::sqrt(dx * dx + dz * dz);
+    }
+};
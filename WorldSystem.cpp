@@ -1,3 +1,9 @@
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <numeric>
 #include <random>
 #include "WorldSystem.h"
 #include "CullingSoa.h"
@@ -5,37 +11,50 @@
 #include "Instance.h"
 #include "StaticObject.h"
 #include "BvhTree.h"
+#include "GlobalContext.h"
 
 using namespace DirectX::SimpleMath;
 
-namespace DirectX
-{
-    std::vector<uint32_t> TickCulling(const std::vector<BoundingSphere>& data,
-        const BoundingFrustum& frustum)
-    {
-        std::vector<uint32_t> res;
-        res.reserve(data.size());
-        for (uint32_t i = 0; i < data.size(); ++i)
-            if (frustum.Contains(data[i]) != DISJOINT)
-                res.push_back(i);
-        return res;
-    }
-}
-
 namespace 
 {
+    // 12 x 12 cells of about 1333 units, about 1800 objects per cell so the largest ones still fit a 2048 object slot
+    constexpr float WORLD_EXTENT = 8000.0f;
+    constexpr uint32_t WORLD_CELLS_PER_SIDE = 12;
+    constexpr uint32_t RANDOM_OBJECT_COUNT = 1800 * WORLD_CELLS_PER_SIDE * WORLD_CELLS_PER_SIDE;
     constexpr uint32_t BVH_NODE_CAP = 128;
     constexpr BvhTree::SpitMethod BVH_METHOD = BvhTree::SpitMethod::Middle;
+    constexpr uint32_t CULLING_FRONTIER_DEPTH = 4; // up to 16 subtrees choose their own strategy
+    constexpr float VELOCITY_SMOOTHING = 0.2f; // weight of the latest tick in the camera velocity
+    constexpr size_t STREAMING_BUDGET = size_t{ 64 } << 20;
+    constexpr uint64_t EVICTION_AGE = 60; // ticks a cell must go unseen before a waiting cell may take its place
+    constexpr float OBB_VOLUME_RATIO = 0.5f; // boxes under this fraction of the sphere volume are worth the box test
+    constexpr float GEOMETRY_DRAW_DISTANCE = 2500.0f; // for a geometry reaching its unit sphere, smaller ones go sooner
 
-    std::vector<StaticObject> GenerateRandom()
+    constexpr uint32_t INSTANCE_BATCH = 256; // objects gathered per kernel call, 8 KB of SoA
+    constexpr uint32_t SYNC_BATCH = 256; // bounds decoded at a time when syncing the culling mirror
+
+    // Copies src[indices[i]] to dst[i], a memcpy per run of consecutive indices, contained ranges are whole runs.
+    // Plain stores, ModelRenderer reads the records again right away to copy them into the upload buffer.
+    void GatherInstances(const Instance* src, const uint32_t* indices, size_t count, Instance* dst)
     {
-        std::vector<StaticObject> res;
-        res.reserve(SOA_CAPACITY);
+        for (size_t begin = 0; begin < count;)
+        {
+            size_t end = begin + 1;
+            while (end < count && indices[end] == indices[end - 1] + 1) ++end;
+            std::memcpy(dst + begin, src + indices[begin], (end - begin) * sizeof(Instance));
+            begin = end;
+        }
+    }
+
+    ObjectStore GenerateRandom()
+    {
+        ObjectStore res;
+        res.Resize(RANDOM_OBJECT_COUNT);
         std::random_device rd;
         std::mt19937 gen(rd());
-        std::uniform_real_distribution disX(-2000.0f, 2000.0f);
+        std::uniform_real_distribution disX(-WORLD_EXTENT, WORLD_EXTENT);
         std::uniform_real_distribution disY(-2000.0f, 2000.0f);
-        std::uniform_real_distribution disZ(-2000.0f, 2000.0f);
+        std::uniform_real_distribution disZ(-WORLD_EXTENT, WORLD_EXTENT);
         std::uniform_real_distribution disRow(0.0f, DirectX::XM_2PI);
         std::uniform_real_distribution disPitch(0.0f, DirectX::XM_2PI);
         std::uniform_real_distribution disYaw(0.0f, DirectX::XM_2PI);
@@ -43,7 +62,7 @@ namespace
         std::uniform_int_distribution disCol(0, 255);
         std::uniform_int_distribution disMat(0, 31);
         std::uniform_int_distribution disGeo(0, 11);
-        for (uint32_t i = 0; i < SOA_CAPACITY; ++i)
+        for (uint32_t i = 0; i < RANDOM_OBJECT_COUNT; ++i)
         {
             auto pos = Vector3(disX(gen), disY(gen), disZ(gen));
             auto rot = Quaternion::CreateFromYawPitchRoll(disYaw(gen), disPitch(gen), disRow(gen));
@@ -51,71 +70,778 @@ namespace
             uint32_t col = disCol(gen) << 24 | disCol(gen) << 16 | disCol(gen) << 8 | 255;
             auto mat = disMat(gen);
             auto geo = disGeo(gen);
-            res.emplace_back(pos, rot, scale, geo, mat, col);
+            res.Set(i, StaticObject(pos, rot, scale, geo, mat, col));
         }
         return res;
     }
 }
 
-WorldSystem::WorldSystem() : m_Soa(std::make_unique<CullingSoa<SOA_CAPACITY>>())
+WorldSystem::WorldSystem() :
+    m_Soa(std::make_unique<CullingSoa>()), m_BvhNodeCap(BVH_NODE_CAP), m_BvhMethod(BVH_METHOD),
+    m_StreamingBudget(STREAMING_BUDGET)
+{
+}
+
+void WorldSystem::Initialize(const std::vector<Vector3>& geometryExtents, const std::filesystem::path& worldPath)
 {
+    m_Geometries.assign(geometryExtents.size(), GeometrySettings());
+    for (uint32_t geometry = 0; geometry < geometryExtents.size(); ++geometry)
+    {
+        const Vector3& extents = geometryExtents[geometry];
+        auto& settings = m_Geometries[geometry];
+        settings.MaxDrawDistance = GEOMETRY_DRAW_DISTANCE * std::max({ extents.x, extents.y, extents.z });
+        const float boxVolume = 8.0f * extents.x * extents.y * extents.z;
+        if (boxVolume >= OBB_VOLUME_RATIO * 4.0f / 3.0f * DirectX::XM_PI) continue;
+        settings.Kind = BoundKind::Obb;
+        settings.Extents = extents;
+    }
+
+    if (!WorldFile::IsValid(worldPath))
+    {
+        WorldGrid grid;
+        grid.Origin = Vector2(-WORLD_EXTENT, -WORLD_EXTENT);
+        grid.CellSize = 2.0f * WORLD_EXTENT / WORLD_CELLS_PER_SIDE;
+        grid.CellsX = grid.CellsZ = WORLD_CELLS_PER_SIDE;
+        WorldFile::Write(worldPath, grid, GenerateRandom(), m_BvhNodeCap, m_BvhMethod);
+    }
+
+    m_Streamer = std::make_unique<CellStreamer>(worldPath);
+    m_Streamer->SetBvhSettings(m_BvhNodeCap, m_BvhMethod);
+    m_CellSlots.assign(m_Streamer->GetGrid().GetCellCount(), UINT32_MAX);
+    m_Residency = std::make_unique<ResidencyManager>(m_Streamer->GetGrid().GetCellCount());
+    m_Residency->SetBudget(m_StreamingBudget);
+
+    // slots start on a block and page boundary, so a cell never shares a quantization frame or culling page
+    static_assert(ObjectStore::BlockCapacity % CullingSoa::PageCapacity == 0);
+    const uint32_t blocks = (m_Streamer->GetMaxCellObjects() + ObjectStore::BlockCapacity - 1) / ObjectStore::BlockCapacity;
+    m_SlotCapacity = std::max(blocks, 1u) * ObjectStore::BlockCapacity;
 }
 
-void WorldSystem::Initialize()
+void WorldSystem::Tick(const Camera& camera, std::vector<Instance>& instances)
 {
-    m_Objects = GenerateRandom();
-    m_Bvh = std::make_unique<BvhTree>(m_Objects, BVH_NODE_CAP, BVH_METHOD);
+    const CullingContext context = camera.GetCullingContext(m_MinScreenRadius);
+    TickStreaming(camera.GetPosition(), camera.GetForward(), context);
+    SyncDirty();
+    TickCulling(context, instances);
 }
 
-std::vector<Instance> WorldSystem::Tick(const Camera& camera) const
+void WorldSystem::TickStreaming(const Vector3& position, const Vector3& forward, const CullingContext& context)
 {
-    const auto frustum = camera.GetFrustum();
-    auto visible = m_Bvh->TickCulling(frustum);
-    std::vector<DirectX::BoundingSphere> spheres(visible.size());
+    // velocity and turn rate are smoothed, a single long frame or a teleport shouldn't swing priorities
+    using Clock = std::chrono::steady_clock;
+    const auto now = Clock::now();
+    if (m_LastStreamingTick != Clock::time_point{})
+    {
+        const float seconds = std::chrono::duration<float>(now - m_LastStreamingTick).count();
+        if (seconds > 0.0f)
+        {
+            m_CameraVelocity += ((position - m_LastCameraPosition) / seconds - m_CameraVelocity) * VELOCITY_SMOOTHING;
+            // turning about the up axis, from x towards z, looking straight up or down gives no heading
+            const Vector2 from(m_LastCameraForward.x, m_LastCameraForward.z);
+            const Vector2 to(forward.x, forward.z);
+            const float turn = from.LengthSquared() > 1e-4f && to.LengthSquared() > 1e-4f ?
+                std::atan2(from.x * to.y - from.y * to.x, from.Dot(to)) / seconds : 0.0f;
+            m_CameraTurnRate += (turn - m_CameraTurnRate) * VELOCITY_SMOOTHING;
+        }
+    }
+    m_LastStreamingTick = now;
+    m_LastCameraPosition = position;
+    m_LastCameraForward = forward;
+
+    StreamingView view;
+    view.Position = position;
+    view.Velocity = m_CameraVelocity;
+    view.Forward = forward;
+    view.TurnRate = m_CameraTurnRate;
+    view.Frustum = context;
+
+    // resident cells in the frustum are seen this tick, eviction goes by how long ago that was
+    ++m_StreamingTick;
+    std::vector<std::pair<uint32_t, bool>> visibleSlots;
+    uint32_t nodesVisited = 0;
+    m_TopLevel.Cull(context, visibleSlots, nodesVisited);
+    for (const auto& [slot, contained] : visibleSlots) m_Residency->Touch(m_Slots[slot].Cell, m_StreamingTick);
+
+    // over the limit after the budget dropped or footprints grew, seen lately or not
+    const uint32_t cellLimit = GetCellLimit();
+    std::vector<uint32_t> victims;
+    if (m_Residency->GetResidentCount() > cellLimit)
+        m_Residency->SelectVictims(m_Residency->GetResidentCount() - cellLimit, UINT64_MAX, victims);
+    for (const uint32_t cell : victims) EvictCell(cell);
+
+    const uint32_t inUse = m_Streamer->GetResidentCount() + m_Streamer->GetReadingCount() + m_Streamer->GetLoadingCount();
+    const uint32_t maxLoads = GetLoadLimit(inUse);
+    const bool budgetBound = maxLoads < m_Streamer->GetReader().GetFreeBufferCount();
+    StreamingStats stats;
+    std::vector<uint32_t> unloads;
+    m_Streamer->Update(view, unloads, maxLoads);
+    for (const uint32_t cell : unloads) FreeCell(cell);
 
-    for (uint32_t i = 0; i < visible.size(); ++i)
+    // cells the budget kept out take the place of cells unseen for a while, they are issued next tick
+    const size_t evicted = victims.size();
+    if (budgetBound && m_Streamer->GetDeferredCount() > 0)
     {
-        spheres[i].Center = m_Objects[visible[i]].Position;
-        spheres[i].Radius = m_Objects[visible[i]].Scale;
+        const uint64_t visibleBefore = m_StreamingTick > EVICTION_AGE ? m_StreamingTick - EVICTION_AGE : 0;
+        m_Residency->SelectVictims(m_Streamer->GetDeferredCount(), visibleBefore, victims);
+        for (size_t i = evicted; i < victims.size(); ++i) EvictCell(victims[i]);
     }
 
-    //const auto visible2 = m_Soa->TickCulling<xsimd::avx2>(spheres, frustum);
-    //const auto visible2 = TickCulling(spheres, frustum);
-    const auto visible2 = m_Soa->TickCulling(spheres, frustum);
+    std::vector<CellLoad> loads;
+    m_Streamer->TakeCompleted(loads);
+    for (auto& load : loads) InstallCell(load);
+    FinishInstalls(false);
 
-    for (uint32_t i = 0; i < visible2.size(); ++i)
+    const size_t slotCount = m_Slots.size();
+    if (slotCount > cellLimit) CompactSlots(cellLimit);
+
+    // cell trees come built, only the top level is rebuilt
+    stats.TopLevelBuildUs = m_StreamingStats.TopLevelBuildUs;
+    if (!unloads.empty() || m_InstalledThisTick > 0 || !victims.empty() || m_Slots.size() != slotCount)
     {
-        visible[i] = visible[visible2[i]];
+        const auto buildStart = Clock::now();
+        BuildTopLevel();
+        stats.TopLevelBuildUs = std::chrono::duration<float, std::micro>(Clock::now() - buildStart).count();
+        UpdateBvhLeaves();
     }
-    visible.resize(visible2.size());
 
-    std::vector<Instance> instances(visible.size());
-    for (uint32_t i = 0; i < instances.size(); ++i)
+    ResidencyStats residency;
+    residency.Budget = m_StreamingBudget;
+    residency.Used = GetStreamingMemory();
+    residency.ResidentBytes = m_Residency->GetResidentBytes();
+    residency.CellLimit = cellLimit;
+    residency.Evictions = m_ResidencyStats.Evictions + static_cast<uint32_t>(victims.size());
+    m_ResidencyStats = residency;
+
+    stats.ResidentCells = m_Streamer->GetResidentCount();
+    stats.ReadingCells = m_Streamer->GetReadingCount();
+    stats.LoadingCells = m_Streamer->GetLoadingCount() + static_cast<uint32_t>(m_Installs.size());
+    stats.ResidentObjects = m_ResidentObjects;
+    stats.Slots = static_cast<uint32_t>(m_Slots.size());
+    stats.LoadedThisTick = m_InstalledThisTick;
+    stats.UnloadedThisTick = static_cast<uint32_t>(unloads.size());
+    stats.CancelledLoads = m_Streamer->GetCancelledCount();
+    stats.PrefetchReads = m_Streamer->GetPrefetchCount();
+    stats.DemotedPrefetches = m_Streamer->GetDemotedCount();
+    stats.FailedCells = m_Streamer->GetFailedCellCount();
+    m_StreamingStats = stats;
+    m_InstalledThisTick = 0;
+}
+
+void WorldSystem::InstallCell(CellLoad& load)
+{
+    auto freeSlot = std::find_if(m_Slots.begin(), m_Slots.end(),
+        [](const CellSlot& slot) { return slot.Cell == UINT32_MAX; });
+    if (freeSlot == m_Slots.end())
     {
-        const uint32_t objIdx = visible[i];
-        auto& ins = instances[i];
-        ins.World = (Matrix::CreateScale(m_Objects[objIdx].Scale) *
-            Matrix::CreateFromQuaternion(m_Objects[objIdx].Rotation) *
-            Matrix::CreateTranslation(m_Objects[objIdx].Position)).Transpose();
-        ins.GeoIdx = m_Objects[objIdx].GeometryIndex;
-        ins.MatIdx = m_Objects[objIdx].MaterialIndex;
-        ins.Color = m_Objects[objIdx].Color;
-        ins.Param = 0;
+        FinishInstalls(true);
+        m_Slots.emplace_back();
+        freeSlot = std::prev(m_Slots.end());
+        const auto size = static_cast<uint32_t>(m_Slots.size()) * m_SlotCapacity;
+        // exact sizes, growth headroom would count against the budget
+        m_Objects.Resize(size);
+        m_Objects.ShrinkToFit();
+        m_Soa->Resize(size);
+        m_DrawDistances.reserve(size);
+        m_DrawDistances.resize(size);
+        if (m_PrecomputedInstances)
+        {
+            m_StaticInstances.reserve(size);
+            m_StaticInstances.resize(size);
+        }
     }
-    return instances;
+
+    const auto slot = static_cast<uint32_t>(freeSlot - m_Slots.begin());
+    const uint32_t base = slot * m_SlotCapacity;
+    freeSlot->Cell = load.Cell;
+    freeSlot->ObjectCount = load.Objects.GetSize();
+    m_CellSlots[load.Cell] = slot;
+    m_ResidentObjects += freeSlot->ObjectCount;
+
+    // the copy only writes the slot's range, which nothing reads until the cell has its BVH
+    auto staged = std::make_shared<CellLoad>(std::move(load));
+    m_Objects.PrepareAssign(staged->Objects);
+    ObjectStore& objects = m_Objects;
+    m_Installs.push_back({ slot, staged, m_Streamer->Enqueue([&objects, base, staged] { objects.Assign(base, staged->Objects); }) });
 }
 
-uint32_t WorldSystem::GetObjectCount() const
+void WorldSystem::FinishInstalls(bool wait)
+{
+    for (auto it = m_Installs.begin(); it != m_Installs.end();)
+    {
+        if (!wait && it->Copied.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            ++it;
+            continue;
+        }
+
+        it->Copied.get();
+        CellSlot& slot = m_Slots[it->Slot];
+        const uint32_t base = it->Slot * m_SlotCapacity;
+        slot.Bvh = std::move(it->Load->Bvh);
+        slot.Bvh->SetObjectBase(base);
+        if (slot.ObjectCount > 0) MarkDirty(base, base + slot.ObjectCount);
+        m_Residency->Add(slot.Cell, GetSlotBytes() + slot.Bvh->GetTree().size() * sizeof(BvhLinearNode), m_StreamingTick);
+        ++m_InstalledThisTick;
+        it = m_Installs.erase(it);
+    }
+}
+
+void WorldSystem::FreeCell(uint32_t cell)
+{
+    // the slot's objects stay in the stores until reused, nothing refers to them once the BVH is gone
+    if (m_Slots[m_CellSlots[cell]].Bvh == nullptr) FinishInstalls(true);
+    auto& slot = m_Slots[m_CellSlots[cell]];
+    m_ResidentObjects -= slot.ObjectCount;
+    slot = CellSlot();
+    m_CellSlots[cell] = UINT32_MAX;
+    m_Residency->Remove(cell);
+}
+
+void WorldSystem::EvictCell(uint32_t cell)
+{
+    m_Streamer->Evict(cell);
+    FreeCell(cell);
+}
+
+void WorldSystem::CompactSlots(uint32_t limit)
+{
+    if (m_Slots.size() <= limit) return;
+
+    FinishInstalls(true);
+    const auto slotCount = static_cast<uint32_t>(m_Slots.size());
+    while (m_Slots.size() > limit)
+    {
+        CellSlot& last = m_Slots.back();
+        if (last.Bvh != nullptr)
+        {
+            // every slot holding a cell means evictions haven't caught up, they bring the count down first
+            const auto hole = std::find_if(m_Slots.begin(), std::prev(m_Slots.end()),
+                [](const CellSlot& slot) { return slot.Cell == UINT32_MAX; });
+            if (hole == std::prev(m_Slots.end())) break;
+
+            const auto to = static_cast<uint32_t>(hole - m_Slots.begin());
+            const uint32_t from = static_cast<uint32_t>(m_Slots.size() - 1) * m_SlotCapacity;
+            m_Objects.Assign(to * m_SlotCapacity, m_Objects.Extract(from, from + last.ObjectCount));
+            last.Bvh->SetObjectBase(to * m_SlotCapacity);
+            m_CellSlots[last.Cell] = to;
+            if (last.ObjectCount > 0) MarkDirty(to * m_SlotCapacity, to * m_SlotCapacity + last.ObjectCount);
+            *hole = std::move(last);
+        }
+        m_Slots.pop_back();
+    }
+    if (m_Slots.size() == slotCount) return;
+
+    // ranges past the end were for cells that moved or left
+    const auto size = static_cast<uint32_t>(m_Slots.size()) * m_SlotCapacity;
+    for (auto& range : m_DirtyRanges) range.second = std::min(range.second, size);
+    m_DirtyRanges.erase(std::remove_if(m_DirtyRanges.begin(), m_DirtyRanges.end(),
+        [](const auto& range) { return range.first >= range.second; }), m_DirtyRanges.end());
+
+    m_Objects.Resize(size);
+    m_Objects.ShrinkToFit();
+    m_Soa->Resize(size);
+    m_DrawDistances.resize(size);
+    m_DrawDistances.shrink_to_fit();
+    if (m_PrecomputedInstances)
+    {
+        m_StaticInstances.resize(size);
+        m_StaticInstances.shrink_to_fit();
+    }
+}
+
+size_t WorldSystem::GetSlotBytes() const
+{
+    if (m_Slots.empty()) return 0;
+    const size_t bytes = m_Objects.GetMemoryUsage() + m_Soa->GetMemoryUsage() +
+        m_DrawDistances.capacity() * sizeof(float) + m_StaticInstances.capacity() * sizeof(Instance);
+    return bytes / m_Slots.size();
+}
+
+size_t WorldSystem::GetBvhBytes() const
+{
+    size_t bytes = (m_BvhLeaves.capacity() + m_TopLevel.GetTree().capacity()) * sizeof(BvhLinearNode);
+    for (const auto& slot : m_Slots)
+        if (slot.Bvh != nullptr) bytes += slot.Bvh->GetTree().capacity() * sizeof(BvhLinearNode);
+    return bytes;
+}
+
+size_t WorldSystem::GetStagingBytes() const
+{
+    size_t bytes = 0;
+    for (const auto& install : m_Installs)
+        bytes += install.Load->Objects.GetMemoryUsage() + install.Load->Bvh->GetTree().capacity() * sizeof(BvhLinearNode);
+    return bytes;
+}
+
+size_t WorldSystem::GetGrowthBytes() const
+{
+    // columns are reallocated one at a time to their exact size
+    const size_t objects = m_Slots.size() * m_SlotCapacity;
+    return objects * (m_PrecomputedInstances ? sizeof(Instance) : sizeof(float));
+}
+
+size_t WorldSystem::GetStreamingMemory() const
+{
+    return GetSlotBytes() * m_Slots.size() + GetBvhBytes() + m_Streamer->GetMemoryUsage() + GetStagingBytes();
+}
+
+size_t WorldSystem::GetTransientBytes() const
+{
+    return m_Streamer->GetMemoryUsage() + GetStagingBytes() + GetGrowthBytes() +
+        m_Streamer->GetReadingCount() * m_Streamer->GetMaxStagingBytes();
+}
+
+size_t WorldSystem::GetCellBytes() const
+{
+    // nothing to measure a cell by before the first one is in
+    const size_t slotBytes = GetSlotBytes();
+    if (slotBytes == 0) return 0;
+
+    const uint32_t resident = m_Residency->GetResidentCount();
+    return slotBytes + (resident > 0 ? GetBvhBytes() / resident : 0);
+}
+
+uint32_t WorldSystem::GetCellLimit() const
+{
+    const size_t cellBytes = GetCellBytes();
+    if (cellBytes == 0) return 1;
+
+    const size_t fixed = GetTransientBytes();
+    const size_t available = m_StreamingBudget > fixed ? m_StreamingBudget - fixed : 0;
+    return std::max<uint32_t>(1, static_cast<uint32_t>(available / cellBytes));
+}
+
+uint32_t WorldSystem::GetLoadLimit(uint32_t inUse) const
 {
-    return m_Objects.size();
+    // the first cell is always let in, streaming stalls otherwise
+    const size_t cellBytes = GetCellBytes();
+    if (cellBytes == 0 || inUse == 0) return inUse == 0 ? 1 : 0;
+
+    const size_t used = GetTransientBytes() + inUse * cellBytes;
+    if (m_StreamingBudget <= used) return 0;
+    return static_cast<uint32_t>((m_StreamingBudget - used) / (cellBytes + m_Streamer->GetMaxStagingBytes()));
 }
 
-const std::vector<BvhLinearNode>& WorldSystem::GetBvhTree() const
+void WorldSystem::UpdateBvhLeaves()
 {
-    return m_Bvh->GetTree();
+    m_BvhLeaves.clear();
+    for (const auto& slot : m_Slots)
+    {
+        if (slot.Bvh == nullptr) continue;
+        for (const auto& node : slot.Bvh->GetTree())
+            if (node.ObjectCount > 0) m_BvhLeaves.push_back(node);
+    }
+}
+
+void WorldSystem::BuildTopLevel()
+{
+    std::vector<TopLevelBvh::Leaf> leaves;
+    for (uint32_t slot = 0; slot < m_Slots.size(); ++slot)
+    {
+        const auto& bvh = m_Slots[slot].Bvh;
+        if (bvh == nullptr || bvh->GetTree().empty()) continue;
+        const BvhLinearNode& root = bvh->GetTree().front();
+        leaves.push_back({ slot, root.Bound, root.MaxDrawDistance });
+    }
+    m_TopLevel.Build(std::move(leaves));
+}
+
+void WorldSystem::TickCulling(const CullingContext& context, std::vector<Instance>& instances)
+{
+    using Clock = std::chrono::steady_clock;
+    CullingStats stats;
+    stats.Strategy = m_Strategy;
+
+    // the top level picks the cells in the frustum, the top levels of their trees sort subtrees into culled,
+    // contained and crossing, crossing ones are traversed or scanned, whichever the cost model expects to be cheaper
+    const auto traversalStart = Clock::now();
+    std::vector<BvhObjectRange> ranges;
+    uint32_t containedObjects = 0, crossingObjects = 0;
+    std::vector<std::pair<uint32_t, bool>> visibleSlots;
+    if (m_Strategy == CullingStrategy::BruteForce)
+    {
+        for (uint32_t slot = 0; slot < m_Slots.size(); ++slot)
+            if (m_Slots[slot].Bvh != nullptr) visibleSlots.emplace_back(slot, false);
+    }
+    else
+    {
+        m_TopLevel.Cull(context, visibleSlots, stats.NodesVisited);
+        // slots are walked in order, so ranges stay ascending
+        std::sort(visibleSlots.begin(), visibleSlots.end());
+    }
+    for (const auto& [slot, contained] : visibleSlots)
+    {
+        const auto& bvh = m_Slots[slot].Bvh;
+        if (m_Strategy == CullingStrategy::BruteForce)
+        {
+            AppendObjectRange(ranges, { slot * m_SlotCapacity, m_Slots[slot].ObjectCount, false });
+            crossingObjects += m_Slots[slot].ObjectCount;
+            ++stats.ScannedSubtrees;
+            continue;
+        }
+        if (contained)
+        {
+            AppendObjectRange(ranges, { slot * m_SlotCapacity, m_Slots[slot].ObjectCount, true });
+            containedObjects += m_Slots[slot].ObjectCount;
+            continue;
+        }
+
+        for (const auto& subtree : bvh->GetFrontier(context, CULLING_FRONTIER_DEPTH, stats.NodesVisited))
+        {
+            if (subtree.Contained)
+            {
+                AppendObjectRange(ranges, { subtree.ObjectOffset, subtree.ObjectCount, true });
+                containedObjects += subtree.ObjectCount;
+            }
+            else if (m_Strategy == CullingStrategy::Auto && m_CostModel.PreferScan(subtree.NodeCount, subtree.ObjectCount))
+            {
+                AppendObjectRange(ranges, { subtree.ObjectOffset, subtree.ObjectCount, false });
+                crossingObjects += subtree.ObjectCount;
+                ++stats.ScannedSubtrees;
+            }
+            else
+            {
+                bvh->TickCulling(context, subtree.Node, false, ranges, stats.NodesVisited);
+                crossingObjects += subtree.ObjectCount;
+                ++stats.TraversedSubtrees;
+            }
+        }
+    }
+    const auto scanStart = Clock::now();
+    // every piece's records go straight to their final place in instances, split over the culling tasks.
+    // Resizing comes between the passes, the emit pass is timed on its own so the scan cost stays clean.
+    auto scanEnd = scanStart;
+    const auto resize = [&](uint32_t total)
+    {
+        scanEnd = Clock::now();
+        instances.resize(total);
+    };
+    if (m_PrecomputedInstances)
+    {
+        // records are ready, only gather them
+        m_Soa->TickCulling(context, ranges, resize, [&](const uint32_t* visible, uint32_t count, uint32_t offset)
+        {
+            GatherInstances(m_StaticInstances.data(), visible, count, instances.data() + offset);
+        });
+    }
+    else
+    {
+        m_Soa->TickCulling(context, ranges, resize, [&](const uint32_t* visible, uint32_t count, uint32_t offset)
+        {
+            BuildInstances(visible, count, instances.data() + offset);
+        });
+    }
+    const auto emitEnd = Clock::now();
+
+    for (const auto& range : ranges)
+        if (!range.Contained || context.HasContributionCulling()) stats.ObjectsTested += range.Count;
+    stats.VisibleCount = static_cast<uint32_t>(instances.size());
+    stats.TraversalMs = std::chrono::duration<float, std::milli>(scanStart - traversalStart).count();
+    stats.ScanMs = std::chrono::duration<float, std::milli>(scanEnd - scanStart).count();
+    stats.EmitMs = std::chrono::duration<float, std::milli>(emitEnd - scanEnd).count();
+
+    const uint32_t visibleCrossing = stats.VisibleCount > containedObjects ? stats.VisibleCount - containedObjects : 0;
+    m_CostModel.Update(stats.NodesVisited, stats.TraversalMs, stats.ObjectsTested, stats.ScanMs,
+        crossingObjects, visibleCrossing);
+    stats.VisibleFraction = m_CostModel.GetVisibleFraction();
+    stats.NodeCostNs = m_CostModel.GetNodeCostNs();
+    stats.ObjectCostNs = m_CostModel.GetObjectCostNs();
+    m_Stats = stats;
+}
+
+void WorldSystem::BuildInstances(const uint32_t* indices, uint32_t count, Instance* out) const
+{
+    // placements are gathered into SoA lanes, widened from 16 bit by the store when compact. Rotations go
+    // through the SIMD encoder, which writes the packed words in place, unless the store keeps them packed.
+    alignas(64) float placements[4][INSTANCE_BATCH];
+    alignas(64) float rotations[4][INSTANCE_BATCH];
+    RotationColumns columns;
+    columns.X = rotations[0];
+    columns.Y = rotations[1];
+    columns.Z = rotations[2];
+    columns.W = rotations[3];
+    const auto& kernels = CullingDispatcher::GetKernels();
+    const bool packed = m_Objects.IsCompact();
+
+    for (uint32_t begin = 0; begin < count; begin += INSTANCE_BATCH)
+    {
+        const uint32_t batch = std::min(INSTANCE_BATCH, count - begin);
+        m_Objects.GatherPlacements(indices + begin, batch, placements[0], placements[1], placements[2], placements[3]);
+        for (uint32_t i = 0; i < batch; ++i)
+        {
+            const uint32_t index = indices[begin + i];
+            Instance& instance = out[begin + i];
+            instance.Position = Vector3(placements[0][i], placements[1][i], placements[2][i]);
+            instance.Scale = placements[3][i];
+            instance.Ids = InstancePacking::PackIds(m_Objects.GetGeometryIndex(index), m_Objects.GetMaterialIndex(index));
+            instance.Color = m_Objects.GetColor(index);
+            instance.Param = 0;
+            if (packed)
+            {
+                instance.Rotation = m_Objects.GetPackedRotation(index);
+            }
+            else
+            {
+                const Quaternion rotation = m_Objects.GetRotation(index);
+                rotations[0][i] = rotation.x;
+                rotations[1][i] = rotation.y;
+                rotations[2][i] = rotation.z;
+                rotations[3][i] = rotation.w;
+            }
+        }
+        if (!packed) kernels.PackRotations(columns, batch, &out[begin].Rotation, sizeof(Instance) / sizeof(uint32_t));
+    }
+}
+
+void WorldSystem::UpdateObject(uint32_t index, const StaticObject& object)
+{
+    const uint32_t slot = m_SlotCapacity > 0 ? index / m_SlotCapacity : 0;
+    if (slot >= m_Slots.size() || index - slot * m_SlotCapacity >= m_Slots[slot].ObjectCount) return;
+
+    FinishInstalls(true);
+    m_Objects.Set(index, object);
+    MarkDirty(index, index + 1);
+}
+
+void WorldSystem::MarkDirty(uint32_t begin, uint32_t end)
+{
+    if (!m_DirtyRanges.empty() && m_DirtyRanges.back().second >= begin && m_DirtyRanges.back().first <= end)
+    {
+        auto& last = m_DirtyRanges.back();
+        last = { std::min(last.first, begin), std::max(last.second, end) };
+    }
+    else
+    {
+        m_DirtyRanges.emplace_back(begin, end);
+    }
+}
+
+void WorldSystem::MarkResidentDirty()
+{
+    for (uint32_t slot = 0; slot < m_Slots.size(); ++slot)
+        if (m_Slots[slot].Bvh != nullptr && m_Slots[slot].ObjectCount > 0)
+            MarkDirty(slot * m_SlotCapacity, slot * m_SlotCapacity + m_Slots[slot].ObjectCount);
+}
+
+void WorldSystem::SyncDirty()
+{
+    if (m_DirtyRanges.empty()) return;
+
+    alignas(64) float spheres[4][SYNC_BATCH];
+    for (const auto& [begin, end] : m_DirtyRanges)
+    {
+        for (uint32_t first = begin; first < end; first += SYNC_BATCH)
+        {
+            const uint32_t last = std::min(end, first + SYNC_BATCH);
+            m_Objects.GetBounds(first, last, spheres[0], spheres[1], spheres[2], spheres[3]);
+            for (uint32_t i = first; i < last; ++i)
+            {
+                const uint32_t lane = i - first;
+                const DirectX::BoundingSphere sphere(Vector3(spheres[0][lane], spheres[1][lane], spheres[2][lane]), spheres[3][lane]);
+                const uint32_t geometry = m_Objects.GetGeometryIndex(i);
+                if (geometry < m_Geometries.size() && m_Geometries[geometry].Kind != BoundKind::Sphere)
+                {
+                    // padded by how far a compact object may be off, like the sphere
+                    const auto& bounds = m_Geometries[geometry];
+                    const Vector3 extents = bounds.Extents * m_Objects.GetScale(i) + Vector3(m_Objects.GetBoundPadding(i));
+                    m_Soa->Set(i, sphere, DirectX::BoundingOrientedBox(sphere.Center, extents, m_Objects.GetRotation(i)), bounds.Kind);
+                }
+                else
+                {
+                    m_Soa->Set(i, sphere);
+                }
+                m_DrawDistances[i] = GetDrawDistance(i);
+                m_Soa->SetDrawDistance(i, m_DrawDistances[i]);
+            }
+        }
+    }
+    if (m_PrecomputedInstances)
+    {
+        m_StaticInstances.resize(m_Objects.GetSize());
+        std::vector<uint32_t> indices;
+        for (const auto& [begin, end] : m_DirtyRanges)
+        {
+            indices.resize(end - begin);
+            std::iota(indices.begin(), indices.end(), begin);
+            BuildInstances(indices.data(), end - begin, m_StaticInstances.data() + begin);
+        }
+    }
+    m_Soa->Quantize();
+
+    // refit the cells the ranges touch, once each
+    std::vector<bool> refit(m_Slots.size(), false);
+    for (const auto& [begin, end] : m_DirtyRanges)
+        for (uint32_t slot = begin / m_SlotCapacity; slot <= (end - 1) / m_SlotCapacity; ++slot)
+            refit[slot] = true;
+    bool refitTopLevel = false;
+    for (uint32_t slot = 0; slot < m_Slots.size(); ++slot)
+    {
+        const auto& bvh = m_Slots[slot].Bvh;
+        if (!refit[slot] || bvh == nullptr || bvh->GetTree().empty()) continue;
+        bvh->Refit(m_Objects, m_DrawDistances);
+        m_TopLevel.SetLeaf(slot, bvh->GetTree().front().Bound, bvh->GetTree().front().MaxDrawDistance);
+        refitTopLevel = true;
+    }
+    if (refitTopLevel) m_TopLevel.Refit();
+    m_DirtyRanges.clear();
+}
+
+void WorldSystem::SetGeometryBounds(uint32_t geometryIndex, BoundKind kind, const Vector3& extents)
+{
+    if (geometryIndex >= m_Geometries.size()) m_Geometries.resize(geometryIndex + 1);
+    m_Geometries[geometryIndex].Kind = kind;
+    m_Geometries[geometryIndex].Extents = extents;
+
+    // objects are not grouped by geometry, resync all of them
+    MarkResidentDirty();
+}
+
+void WorldSystem::SetGeometryDrawDistance(uint32_t geometryIndex, float maxDistance)
+{
+    if (geometryIndex >= m_Geometries.size()) m_Geometries.resize(geometryIndex + 1);
+    m_Geometries[geometryIndex].MaxDrawDistance = std::max(maxDistance, 0.0f);
+    MarkResidentDirty();
+}
+
+float WorldSystem::GetDrawDistance(uint32_t index) const
+{
+    const float objectDistance = m_Objects.GetMaxDrawDistance(index);
+    if (objectDistance > 0.0f) return objectDistance;
+    const uint32_t geometry = m_Objects.GetGeometryIndex(index);
+    if (geometry < m_Geometries.size() && m_Geometries[geometry].MaxDrawDistance > 0.0f)
+        return m_Geometries[geometry].MaxDrawDistance;
+    return FLT_MAX;
+}
+
+void WorldSystem::SetQuantizedCulling(bool quantized)
+{
+    m_Soa->SetQuantized(quantized);
+}
+
+bool WorldSystem::IsQuantizedCulling() const
+{
+    return m_Soa->IsQuantized();
+}
+
+void WorldSystem::SetMinScreenRadius(float pixels)
+{
+    m_MinScreenRadius = std::max(pixels, 0.0f);
+}
+
+float WorldSystem::GetMinScreenRadius() const
+{
+    return m_MinScreenRadius;
+}
+
+void WorldSystem::SetCullingStrategy(CullingStrategy strategy)
+{
+    m_Strategy = strategy;
+}
+
+void WorldSystem::SetPrecomputedInstances(bool precomputed)
+{
+    if (precomputed == m_PrecomputedInstances) return;
+
+    m_PrecomputedInstances = precomputed;
+    if (precomputed)
+    {
+        m_StaticInstances.resize(m_Objects.GetSize());
+        MarkResidentDirty();
+    }
+    else
+    {
+        m_StaticInstances.clear();
+        m_StaticInstances.shrink_to_fit();
+    }
+}
+
+void WorldSystem::SetCompactObjects(bool compact)
+{
+    if (compact == m_Objects.IsCompact()) return;
+
+    // decoded objects and their bounds change
+    FinishInstalls(true);
+    m_Objects.SetCompact(compact);
+    MarkResidentDirty();
+}
+
+bool WorldSystem::IsCompactObjects() const
+{
+    return m_Objects.IsCompact();
+}
+
+size_t WorldSystem::GetObjectMemoryUsage() const
+{
+    return m_Objects.GetMemoryUsage();
+}
+
+StaticObject WorldSystem::GetStaticObject(uint32_t index) const
+{
+    return m_Objects.Get(index);
+}
+
+void WorldSystem::SetStreamingBudget(size_t bytes)
+{
+    m_StreamingBudget = bytes;
+    m_Residency->SetBudget(bytes);
+}
+
+size_t WorldSystem::GetStreamingBudget() const
+{
+    return m_StreamingBudget;
+}
+
+void WorldSystem::SetStreamingRadii(float inner, float outer)
+{
+    m_Streamer->SetRadii(inner, outer);
+}
+
+float WorldSystem::GetStreamingInnerRadius() const
+{
+    return m_Streamer->GetInnerRadius();
+}
+
+float WorldSystem::GetStreamingOuterRadius() const
+{
+    return m_Streamer->GetOuterRadius();
+}
+
+void WorldSystem::SetPrefetchHorizon(float seconds)
+{
+    m_Streamer->SetPrefetchHorizon(seconds);
+}
+
+float WorldSystem::GetPrefetchHorizon() const
+{
+    return m_Streamer->GetPrefetchHorizon();
+}
+
+uint32_t WorldSystem::GetObjectCount() const
+{
+    return m_ResidentObjects;
 }
 
 void WorldSystem::GenerateBvh(uint32_t objInNode, BvhTree::SpitMethod method)
 {
-    m_Bvh->GenerateTree(m_Objects, objInNode, method);
+    m_BvhNodeCap = objInNode;
+    m_BvhMethod = method;
+    m_Streamer->SetBvhSettings(objInNode, method);
+    FinishInstalls(true);
+
+    // rebuilding reorders the objects of every resident cell, the whole mirror is stale
+    for (uint32_t slot = 0; slot < m_Slots.size(); ++slot)
+    {
+        auto& cell = m_Slots[slot];
+        if (cell.Bvh == nullptr) continue;
+
+        const uint32_t base = slot * m_SlotCapacity;
+        ObjectStore objects = m_Objects.Extract(base, base + cell.ObjectCount);
+        cell.Bvh->GenerateTree(objects, objInNode, method);
+        m_Objects.Assign(base, objects);
+        cell.Bvh->SetObjectBase(base);
+    }
+    m_DirtyRanges.clear();
+    MarkResidentDirty();
+    BuildTopLevel();
+    UpdateBvhLeaves();
 }
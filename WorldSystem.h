@@ -1,19 +1,23 @@
 #pragma once
 #define NOMINMAX
+#include <chrono>
+#include <filesystem>
 #include <memory>
 #include <vector>
 #include <directxtk/SimpleMath.h>
 
+#include "CellStreamer.h"
 #include "CullingSoa.h"
+#include "CullingStrategy.h"
 #include "BvhTree.h"
+#include "ObjectStore.h"
+#include "ResidencyManager.h"
+#include "TopLevelBvh.h"
 
 struct Instance;
-struct StaticObject;
 class Camera;
 class Renderer;
 
-constexpr uint32_t SOA_CAPACITY = 1 << 13;
-
 class WorldSystem
 {
 public:
@@ -21,17 +25,177 @@ public:
     WorldSystem();
     ~WorldSystem() = default;
 
-    void Initialize();
-    [[nodiscard]] std::vector<Instance> Tick(const Camera& camera) const;
+    // Starts streaming the world file at worldPath, a random world is written there first unless it holds one.
+    // geometryExtents are the half extents of each geometry inside its unit bounding sphere, geometries a box
+    // fits much tighter than the sphere are culled with oriented boxes. Draw distances scale with the largest
+    // extent, so geometries that fill less of their sphere go sooner.
+    void Initialize(const std::vector<DirectX::SimpleMath::Vector3>& geometryExtents,
+        const std::filesystem::path& worldPath = "World.bin");
+    // Streams cells around the camera and fills instances with the visible objects, the caller keeps the buffer across ticks
+    void Tick(const Camera& camera, std::vector<Instance>& instances);
+
+    // Objects live in the slot of their cell and are BVH ordered within it, indices change on GenerateBvh
+    // and when the cell is unloaded
+    void UpdateObject(uint32_t index, const StaticObject& object);
+    [[nodiscard]] StaticObject GetStaticObject(uint32_t index) const;
+
+    // Half extents of a geometry inside its unit bounding sphere, scaled like the sphere per object.
+    // Overrides what Initialize picked from the geometry extents.
+    void SetGeometryBounds(uint32_t geometryIndex, BoundKind kind, const DirectX::SimpleMath::Vector3& extents);
+    // Objects of the geometry further than this from the camera are culled, 0 for no limit.
+    // StaticObject::MaxDrawDistance overrides it per object, Initialize sets one from the geometry extents.
+    void SetGeometryDrawDistance(uint32_t geometryIndex, float maxDistance);
+
+    // 16 bit culling bounds, see CullingSoa::SetQuantized
+    void SetQuantizedCulling(bool quantized);
+    [[nodiscard]] bool IsQuantizedCulling() const;
+
+    // Contribution culling, objects and BVH nodes smaller than this on screen are skipped. Off at 0, the
+    // default, on it every object of a contained range is still tested.
+    void SetMinScreenRadius(float pixels);
+    [[nodiscard]] float GetMinScreenRadius() const;
+
+    // Auto picks BVH traversal or a brute force scan per top level subtree every tick
+    void SetCullingStrategy(CullingStrategy strategy);
+    [[nodiscard]] CullingStrategy GetCullingStrategy() const { return m_Strategy; }
+    [[nodiscard]] const CullingStats& GetCullingStats() const { return m_Stats; }
+
+    // Keeps a ready to upload Instance per object, BVH ordered, so Tick only gathers visible records.
+    // Costs sizeof(Instance) per object.
+    void SetPrecomputedInstances(bool precomputed);
+    [[nodiscard]] bool IsPrecomputedInstances() const { return m_PrecomputedInstances; }
+
+    // Quantized object storage, see ObjectStore::SetCompact
+    void SetCompactObjects(bool compact);
+    [[nodiscard]] bool IsCompactObjects() const;
+    [[nodiscard]] size_t GetObjectMemoryUsage() const;
+
+    // Cells closer to the camera than inner are loaded, resident ones further than outer unloaded
+    void SetStreamingRadii(float inner, float outer);
+    [[nodiscard]] float GetStreamingInnerRadius() const;
+    [[nodiscard]] float GetStreamingOuterRadius() const;
+    // Cells the camera is predicted to bring in range within this many seconds are read ahead, 0 disables
+    void SetPrefetchHorizon(float seconds);
+    [[nodiscard]] float GetPrefetchHorizon() const;
+    [[nodiscard]] const StreamingStats& GetStreamingStats() const { return m_StreamingStats; }
 
+    // Caps what streaming holds: cell slots in the object store and culling mirror, cell BVHs, read buffers and
+    // the staging stores loads decode into. A read is only issued if its cell and staging store fit. Cells not
+    // visible lately are evicted for cells waiting to load, over the budget the least recently visible go first.
+    // Geometry is loaded up front and not part of it.
+    void SetStreamingBudget(size_t bytes);
+    [[nodiscard]] size_t GetStreamingBudget() const;
+    [[nodiscard]] const ResidencyStats& GetResidencyStats() const { return m_ResidencyStats; }
+
+    // objects in resident cells
     [[nodiscard]] uint32_t GetObjectCount() const;
-    [[nodiscard]] const std::vector<BvhLinearNode>& GetBvhTree() const;
+    // Leaves of the BVHs of resident cells, updated in place as cells come and go
+    [[nodiscard]] const std::vector<BvhLinearNode>& GetBvhLeaves() const { return m_BvhLeaves; }
+    // Rebuilds the BVH of every resident cell, cells loaded later are built with the same settings
     void GenerateBvh(uint32_t objInNode, BvhTree::SpitMethod method);
 
 private:
 
-    std::vector<StaticObject> m_Objects{};
-    std::unique_ptr<CullingSoa<SOA_CAPACITY>> m_Soa = nullptr;
-    std::unique_ptr<BvhTree> m_Bvh = nullptr;
+    // A resident cell occupies a slot of m_SlotCapacity objects in m_Objects and the culling mirror,
+    // its BVH is built over the slot
+    struct CellSlot
+    {
+        uint32_t Cell = UINT32_MAX; // free when UINT32_MAX
+        uint32_t ObjectCount = 0;
+        std::unique_ptr<BvhTree> Bvh = nullptr; // null while the cell is copied in
+    };
+
+    // A decoded cell being copied into its slot on the streaming workers. The decode can't go straight into
+    // the slot: m_Objects is reallocated on this thread as slots come and go, and quantizes per block when compact.
+    struct SlotInstall
+    {
+        uint32_t Slot = 0;
+        std::shared_ptr<CellLoad> Load = nullptr; // kept alive until copied
+        std::future<void> Copied{};
+    };
+
+    void TickStreaming(const DirectX::SimpleMath::Vector3& position, const DirectX::SimpleMath::Vector3& forward,
+        const CullingContext& context);
+    // Takes a slot for the load and starts copying it in, the cell is culled once FinishInstalls sees it copied
+    void InstallCell(CellLoad& load);
+    // Hands copied cells their BVH, waiting for copies still running if asked. Anything that reallocates or
+    // rewrites m_Objects waits first.
+    void FinishInstalls(bool wait);
+    void FreeCell(uint32_t cell);
+    void EvictCell(uint32_t cell);
+    // Releases slots past limit, moving their cells into free slots further down
+    void CompactSlots(uint32_t limit);
+    // Storage of one slot across the object store, culling mirror and per object arrays, 0 before the first
+    [[nodiscard]] size_t GetSlotBytes() const;
+    [[nodiscard]] size_t GetBvhBytes() const;
+    // staging stores of cells being copied into their slots
+    [[nodiscard]] size_t GetStagingBytes() const;
+    // the old copy of the widest per object column, live while the stores grow by a slot
+    [[nodiscard]] size_t GetGrowthBytes() const;
+    [[nodiscard]] size_t GetStreamingMemory() const;
+    // What loads hold for now on top of cells' slots and BVHs: read buffers, staging stores decoding, being
+    // copied in or still to come for reads in flight, and the overlap while the stores grow
+    [[nodiscard]] size_t GetTransientBytes() const;
+    // slot and BVH share of a cell, 0 before the first
+    [[nodiscard]] size_t GetCellBytes() const;
+    // cells resident or loading at once that fit the budget, at least one
+    [[nodiscard]] uint32_t GetCellLimit() const;
+    // reads that fit the budget on top of inUse cells resident or loading, each with a staging store of its own
+    [[nodiscard]] uint32_t GetLoadLimit(uint32_t inUse) const;
+    // Marks the objects of every resident cell dirty
+    void MarkResidentDirty();
+    void UpdateBvhLeaves();
+    // over the root bounds of the resident cells, after cells came, went or moved slots
+    void BuildTopLevel();
+
+    void TickCulling(const CullingContext& context, std::vector<Instance>& instances);
+    // Writes an Instance per index to out, rotations are packed by the SIMD kernels
+    void BuildInstances(const uint32_t* indices, uint32_t count, Instance* out) const;
+
+    void MarkDirty(uint32_t begin, uint32_t end);
+    // Pushes dirty object ranges into the culling mirror and refits the cell BVHs and the top level
+    void SyncDirty();
+
+    struct GeometrySettings
+    {
+        BoundKind Kind = BoundKind::Sphere;
+        DirectX::SimpleMath::Vector3 Extents{};
+        float MaxDrawDistance = 0.0f;
+    };
+
+    [[nodiscard]] float GetDrawDistance(uint32_t index) const;
+
+    ObjectStore m_Objects{}; // cell slots, BVH ordered within each
+    std::vector<GeometrySettings> m_Geometries{};
+    std::vector<float> m_DrawDistances{}; // resolved per object, index aligned with m_Objects
+    std::vector<std::pair<uint32_t, uint32_t>> m_DirtyRanges{};
+    std::unique_ptr<CullingSoa> m_Soa = nullptr;
+    std::unique_ptr<CellStreamer> m_Streamer = nullptr;
+    std::vector<CellSlot> m_Slots{};
+    std::vector<SlotInstall> m_Installs{};
+    uint32_t m_InstalledThisTick = 0; // installs finished since the last streaming stats
+    std::vector<uint32_t> m_CellSlots{}; // per grid cell, UINT32_MAX unless resident
+    uint32_t m_SlotCapacity = 0;
+    uint32_t m_ResidentObjects = 0;
+    uint32_t m_BvhNodeCap;
+    BvhTree::SpitMethod m_BvhMethod;
+    std::vector<BvhLinearNode> m_BvhLeaves{};
+    TopLevelBvh m_TopLevel{};
+    StreamingStats m_StreamingStats{};
+    std::unique_ptr<ResidencyManager> m_Residency = nullptr;
+    ResidencyStats m_ResidencyStats{};
+    size_t m_StreamingBudget;
+    uint64_t m_StreamingTick = 0;
+    std::chrono::steady_clock::time_point m_LastStreamingTick{};
+    DirectX::SimpleMath::Vector3 m_LastCameraPosition{};
+    DirectX::SimpleMath::Vector3 m_CameraVelocity{};
+    DirectX::SimpleMath::Vector3 m_LastCameraForward{};
+    float m_CameraTurnRate = 0.0f;
+    float m_MinScreenRadius = 0.0f; // off, so contained ranges skip the per object tests
+    CullingStrategy m_Strategy = CullingStrategy::Auto;
+    CullingCostModel m_CostModel{};
+    CullingStats m_Stats{};
+    std::vector<Instance> m_StaticInstances{}; // index aligned with m_Objects when precomputed
+    bool m_PrecomputedInstances = false;
 };
 